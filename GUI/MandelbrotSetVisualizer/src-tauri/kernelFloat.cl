@@ -0,0 +1,87 @@
+// Built with -D COMPACT_ITERS when max_iter fits 16 bits, -1 then stores as 0xFFFF
+#ifdef COMPACT_ITERS
+typedef ushort iter_t;
+#else
+typedef int iter_t;
+#endif
+
+typedef struct {
+	float real;
+	float imag;
+} ComplexFloat;
+
+// Same formula specialization as kernel.cl
+#ifndef FORMULA_POWER
+#define FORMULA_POWER 2
+#endif
+#ifdef FORMULA_BURNING_SHIP
+#define FORMULA_ABS(v) fabs(v)
+#else
+#define FORMULA_ABS(v) (v)
+#endif
+
+// Single precision for shallow zooms and previews, no double arithmetic so it also builds on devices without fp64
+__kernel void calculateIters(__global ComplexFloat* IN, __global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height)
+{
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
+	ComplexFloat c = IN[idx];
+
+#ifdef FORMULA_JULIA
+	float x0 = JULIA_RE;
+	float y0 = JULIA_IM;
+
+	float x = c.real;
+	float y = c.imag;
+
+	float x2 = x * x;
+	float y2 = y * y;
+#else
+	float x0 = c.real;
+	float y0 = c.imag;
+
+	float x2 = 0;
+	float y2 = 0;
+
+	float x = 0;
+	float y = 0;
+#endif
+
+	int result = -1;
+	for (int i = 0; i < max_iter; i++) {
+#if FORMULA_POWER == 2
+#ifdef FORMULA_BURNING_SHIP
+		y = 2 * fabs(x * y) + y0;
+#else
+		y = (x + x) * y + y0;
+#endif
+		x = x2 - y2 + x0;
+#else
+		float zr = FORMULA_ABS(x);
+		float zi = FORMULA_ABS(y);
+		float pr = zr;
+		float pi = zi;
+		for (int p = 1; p < FORMULA_POWER; p++) {
+			float t = pr * zr - pi * zi;
+			pi = pr * zi + pi * zr;
+			pr = t;
+		}
+		x = pr + x0;
+		y = pi + y0;
+#endif
+		x2 = x * x;
+		y2 = y * y;
+		if (x2 + y2 > 4) {
+			result = i;
+			break;
+		}
+	}
+
+	OUT[idx] = (iter_t)result;
+
+	return;
+}
@@ -1,42 +1,194 @@
 // Prevents additional console window on Windows in release, DO NOT REMOVE!!
 #![cfg_attr(not(debug_assertions), windows_subsystem = "windows")]
 
+use std::fs::File;
+use std::path::Path;
+use std::sync::atomic::{fence, AtomicU64, Ordering};
+use memmap2::Mmap;
+use tauri::http::ResponseBuilder;
 use tokio::process::Command;
+use tokio::sync::Mutex;
+
+const SHARED_FRAME_FILE: &str = "./../generated-files/frame_buffer.bin";
+const SHARED_FRAME_MAGIC: &[u8] = b"MBFB";
+const SHARED_FRAME_HEADER: usize = 64;
+const CANCEL_FILE_PREFIX: &str = "./../generated-files/cancel_";
+const ITERATION_MAP_FILE: &str = "./../generated-files/last_frame.mbi";
+// Exit code of the renderer when it stopped because its cancel file appeared
+const EXIT_CANCELLED: i32 = 2;
+
+static RENDER_GENERATION: AtomicU64 = AtomicU64::new(0);
+// Held while a renderer process runs
+static RENDER_LOCK: Mutex<()> = Mutex::const_new(());
+
+struct Frame {
+    id: u64,
+    width: u32,
+    height: u32,
+    rgba: Vec<u8>,
+}
+
+fn read_u32(data: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(data[offset..offset + 4].try_into().unwrap())
+}
+
+fn read_u64_volatile(data: &[u8], offset: usize) -> u64 {
+    let value = unsafe { std::ptr::read_volatile(data[offset..offset + 8].as_ptr() as *const [u8; 8]) };
+    u64::from_le_bytes(value)
+}
+
+// Copies the newest frame out of the ring buffer written by the renderer (--shared-frame).
+// A slot whose id changes while it is copied is being overwritten, so the copy is retried.
+fn read_latest_frame() -> Option<Frame> {
+    let file = File::open(SHARED_FRAME_FILE).ok()?;
+    let map = unsafe { Mmap::map(&file) }.ok()?;
+    if map.len() < SHARED_FRAME_HEADER || &map[0..4] != SHARED_FRAME_MAGIC {
+        return None;
+    }
+    let slots = read_u32(&map, 8) as usize;
+    let slot_size = read_u32(&map, 12) as usize;
+    for _ in 0..3 {
+        let id = read_u64_volatile(&map, 16);
+        if id == 0 || slots == 0 {
+            return None;
+        }
+        let slot = ((id - 1) % slots as u64) as usize;
+        let slot_header = SHARED_FRAME_HEADER * (1 + slot);
+        let data_offset = SHARED_FRAME_HEADER * (1 + slots) + slot_size * slot;
+        if map.len() < data_offset + slot_size || read_u64_volatile(&map, slot_header) != id {
+            continue;
+        }
+        fence(Ordering::Acquire);
+        let width = read_u32(&map, slot_header + 8);
+        let height = read_u32(&map, slot_header + 12);
+        let stride = read_u32(&map, slot_header + 16) as usize;
+        let row_bytes = width as usize * 4;
+        if row_bytes > stride || stride * height as usize > slot_size {
+            continue;
+        }
+        let mut rgba = Vec::with_capacity(row_bytes * height as usize);
+        for row in 0..height as usize {
+            let start = data_offset + row * stride;
+            rgba.extend_from_slice(&map[start..start + row_bytes]);
+        }
+        fence(Ordering::Acquire);
+        if read_u64_volatile(&map, slot_header) == id {
+            return Some(Frame { id, width, height, rgba });
+        }
+    }
+    None
+}
+
+fn cancel_file(generation: u64) -> String {
+    format!("{}{}", CANCEL_FILE_PREFIX, generation)
+}
+
+// Every render gets its own cancel file, starting a render cancels the one before it
+fn begin_render() -> String {
+    let generation = RENDER_GENERATION.fetch_add(1, Ordering::SeqCst) + 1;
+    if generation > 1 {
+        let _ = File::create(cancel_file(generation - 1));
+    }
+    cancel_file(generation)
+}
+
+fn end_render(cancel: &str, status: std::process::ExitStatus) -> String {
+    let _ = std::fs::remove_file(cancel);
+    if status.code() == Some(EXIT_CANCELLED) {
+        "cancelled".to_string()
+    } else {
+        status.to_string()
+    }
+}
+
+// Palette changes only recolour the iterations saved by the last finished render. Full renders remove them first,
+// so a cancelled render never leaves the iterations of another viewport behind. Only called by run_renderer,
+// once the previous renderer has exited and can no longer write the file.
+fn add_iteration_map_args(command: &mut Command, recolor_only: bool) {
+    if recolor_only && Path::new(ITERATION_MAP_FILE).exists() {
+        command.arg("--recolor").arg(ITERATION_MAP_FILE);
+    } else {
+        let _ = std::fs::remove_file(ITERATION_MAP_FILE);
+        command.arg("--save-iterations").arg(ITERATION_MAP_FILE).arg("--compression").arg("1");
+    }
+}
+
+// Renderers run one at a time. begin_render has cancelled the previous one, waiting for it to exit keeps its
+// frames and iteration map from landing after this render started.
+async fn run_renderer(mut command: Command, cancel: String, recolor_only: bool) -> String {
+    let _running = RENDER_LOCK.lock().await;
+    // Cancelled by a newer render while waiting
+    if Path::new(&cancel).exists() {
+        let _ = std::fs::remove_file(&cancel);
+        return "cancelled".to_string();
+    }
+    add_iteration_map_args(&mut command, recolor_only);
+    let output = command
+        .output()
+        .await
+        .expect("Failed to execute process");
+
+    end_render(&cancel, output.status)
+}
+
+// The renderer stops at its next kernel launch and exits without publishing a frame
+#[tauri::command]
+fn cancel_render() {
+    let generation = RENDER_GENERATION.load(Ordering::SeqCst);
+    if generation > 0 {
+        let _ = File::create(cancel_file(generation));
+    }
+}
 
 #[tauri::command]
-async fn generate_mandelbrot(re_start: f64, re_end: f64, im_start: f64, im_end: f64, max_iter: i32, palette_length: i32, palette_id: i32) -> String{
-    let output = Command::new("./MandelbrotSetParallelOpenCL.exe")
-        .arg("0")
+async fn generate_mandelbrot(re_start: f64, re_end: f64, im_start: f64, im_end: f64, max_iter: i32, palette_length: i32, palette_id: i32, recolor_only: bool) -> String{
+    let cancel = begin_render();
+    let mut command = Command::new("./MandelbrotSetParallelOpenCL.exe");
+    // Automatic precision, shallow views take the float kernel and deeper ones escalate to double and beyond
+    command.arg("1")
         .arg(re_start.to_string()).arg(re_end.to_string()).arg(im_start.to_string()).arg(im_end.to_string())
         .arg("./../generated-files/mandelbrot_set.png")
         .arg(max_iter.to_string()).arg(palette_length.to_string())
         .arg(palette_id.to_string())
-        .output()
-        .await
-        .expect("Failed to execute process");
-
-    output.status.to_string()
+        .arg("--shared-frame").arg(SHARED_FRAME_FILE)
+        .arg("--cancel-file").arg(&cancel);
+    run_renderer(command, cancel, recolor_only).await
 }
 
 
 #[tauri::command]
-async fn generate_mandelbrot_hp(re_start: String, re_end: String, im_start: String, im_end: String, max_iter: i32, palette_length: i32, palette_id: i32) -> String{
-    let output = Command::new("./MandelbrotSetParallelOpenCL.exe")
-        .arg("1")
+async fn generate_mandelbrot_hp(re_start: String, re_end: String, im_start: String, im_end: String, max_iter: i32, palette_length: i32, palette_id: i32, recolor_only: bool) -> String{
+    let cancel = begin_render();
+    let mut command = Command::new("./MandelbrotSetParallelOpenCL.exe");
+    command.arg("1")
         .arg(&re_start).arg(&re_end).arg(&im_start).arg(&im_end)
         .arg("./../generated-files/mandelbrot_set.png")
         .arg(max_iter.to_string()).arg(palette_length.to_string())
         .arg(palette_id.to_string())
-        .output()
-        .await
-        .expect("Failed to execute process");
-
-    output.status.to_string()
+        .arg("--shared-frame").arg(SHARED_FRAME_FILE)
+        .arg("--cancel-file").arg(&cancel);
+    run_renderer(command, cancel, recolor_only).await
 }
 
 fn main() {
     tauri::Builder::default()
-        .invoke_handler(tauri::generate_handler![generate_mandelbrot, generate_mandelbrot_hp])
+        .invoke_handler(tauri::generate_handler![generate_mandelbrot, generate_mandelbrot_hp, cancel_render])
+        .register_uri_scheme_protocol("frame", |_app, _request| {
+            match read_latest_frame() {
+                Some(frame) => ResponseBuilder::new()
+                    .mimetype("application/octet-stream")
+                    .header("X-Frame-Id", frame.id.to_string())
+                    .header("X-Frame-Width", frame.width.to_string())
+                    .header("X-Frame-Height", frame.height.to_string())
+                    .header("Access-Control-Allow-Origin", "*")
+                    .header("Access-Control-Expose-Headers", "*")
+                    .body(frame.rgba),
+                None => ResponseBuilder::new()
+                    .status(404)
+                    .header("Access-Control-Allow-Origin", "*")
+                    .body(Vec::new()),
+            }
+        })
         .run(tauri::generate_context!())
         .expect("error while running tauri application");
 }
@@ -1,4 +1,4 @@
-import { invoke } from "@tauri-apps/api/tauri";
+import { invoke, convertFileSrc } from "@tauri-apps/api/tauri";
 import P5 from "p5";
 import Decimal from "decimal.js";
 
@@ -31,7 +31,9 @@ class BoundaryManager{
   private paletteLength: number = 250;
   private maxIter: number = 700;
   private paletteId: number = 0;
-  private static imgUrl: string = "https://asset.localhost/D%3A%2FFakultet%2F8.%20semestar%2FDiplomski%20rad%2FMandelbrotSetVisualizer%2FGUI%2FMandelbrotSetVisualizer%2Fgenerated-files%2Fmandelbrot_set.png";
+  private static frameUrl: string = convertFileSrc("latest", "frame");
+  private static partialFramePollMs: number = 100;
+  private frameId: number = 0;
 
   public constructor(boundary: Boundary, boxSidesRatio: number[], p5: P5){
     this.lowPrecissionBoundary = boundary;
@@ -43,9 +45,9 @@ class BoundaryManager{
   public setPaletteLength(paletteLength: number){
     this.paletteLength = paletteLength;
     if(this.highPrecission){
-      this.generateMandelbrotHighPrecission();
+      this.generateMandelbrotHighPrecission(true);
     }else{
-      this.generateMandelbrot();
+      this.generateMandelbrot(true);
     }
   }
   public getPaletteLength(): number{
@@ -65,9 +67,9 @@ class BoundaryManager{
   public setPaletteId(id: number){
     this.paletteId = id;
     if(this.highPrecission){
-      this.generateMandelbrotHighPrecission();
+      this.generateMandelbrotHighPrecission(true);
     }else{
-      this.generateMandelbrot();
+      this.generateMandelbrot(true);
     }
   }
 
@@ -249,18 +251,22 @@ class BoundaryManager{
     }
   }
 
-  private async generateMandelbrot(){
+  // Palette changes pass recolorOnly, the renderer then repaints the iterations of the last render without computing them
+  private async generateMandelbrot(recolorOnly: boolean = false){
     const args = {
       ...this.lowPrecissionBoundary,
       maxIter: this.maxIter,
       paletteLength: this.paletteLength,
-      paletteId: this.paletteId
+      paletteId: this.paletteId,
+      recolorOnly: recolorOnly
     };
-    const status = await invoke("generate_mandelbrot", args);
-    this.img = this.p5Client.loadImage(BoundaryManager.imgUrl);
+    const status = await this.showPartialFrames(invoke("generate_mandelbrot", args));
+    if(status !== "cancelled"){
+      await this.loadLatestFrame();
+    }
     console.log("status:" + status);
   }
-  private async generateMandelbrotHighPrecission(){
+  private async generateMandelbrotHighPrecission(recolorOnly: boolean = false){
     const args = {
       reStart: this.highPrecissionBoundary?.reStart.toString(),
       reEnd: this.highPrecissionBoundary?.reEnd.toString(),
@@ -268,13 +274,54 @@ class BoundaryManager{
       imEnd: this.highPrecissionBoundary?.imEnd.toString(),
       maxIter: this.maxIter,
       paletteLength: this.paletteLength,
-      paletteId: this.paletteId
+      paletteId: this.paletteId,
+      recolorOnly: recolorOnly
     };
-    const status = await invoke("generate_mandelbrot_hp", args);
-    this.img = this.p5Client.loadImage(BoundaryManager.imgUrl);
+    const status = await this.showPartialFrames(invoke("generate_mandelbrot_hp", args));
+    if(status !== "cancelled"){
+      await this.loadLatestFrame();
+    }
     console.log("status:" + status);
   }
 
+  // The renderer publishes the tiles nearest to the center first, poll for them until the render finishes
+  private async showPartialFrames(render: Promise<unknown>): Promise<unknown>{
+    let done = false;
+    const finished = render.finally(() => { done = true; });
+    while(!done){
+      await Promise.race([finished, new Promise(resolve => setTimeout(resolve, BoundaryManager.partialFramePollMs))]);
+      if(!done){
+        await this.loadLatestFrame();
+      }
+    }
+    return finished;
+  }
+
+  // A failed fetch only skips this frame, the render itself goes on
+  private async loadLatestFrame(){
+    try{
+      const response = await fetch(BoundaryManager.frameUrl);
+      if(!response.ok){
+        return;
+      }
+      const frameId = Number(response.headers.get("X-Frame-Id"));
+      if(frameId === this.frameId){
+        return;
+      }
+      const width = Number(response.headers.get("X-Frame-Width"));
+      const height = Number(response.headers.get("X-Frame-Height"));
+      const rgba = new Uint8ClampedArray(await response.arrayBuffer());
+      this.frameId = frameId;
+      const img = this.p5Client.createImage(width, height);
+      img.loadPixels();
+      img.pixels.set(rgba);
+      img.updatePixels();
+      this.img = img;
+    }catch(error){
+      console.log("Could not load frame: " + error);
+    }
+  }
+
   public reset(){
     this.maxIter = 700;
     this.paletteLength = 250;
@@ -344,6 +391,12 @@ window.addEventListener("DOMContentLoaded", () => {
       }
     }
 
+    p5.keyPressed = () => {
+      if(p5.keyCode == p5.ESCAPE){
+        invoke("cancel_render");
+      }
+    }
+
     p5.mouseReleased = () => {
       if(!isPressed){
         return;
@@ -0,0 +1,186 @@
+#include <BatchJobs.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+bool endsWith(const string& value, const string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Splits one CSV line, fields may be quoted and contain commas
+vector<string> splitCsvLine(const string& line) {
+    vector<string> fields;
+    string field;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+        }
+        else if (c == ',' && !quoted) {
+            fields.push_back(field);
+            field.clear();
+        }
+        else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+// Looks fields up by their BatchJob member name
+template<typename Get>
+BatchJob makeBatchJob(Get get) {
+    BatchJob job;
+    job.reStart = get("reStart", job.reStart);
+    job.reEnd = get("reEnd", job.reEnd);
+    job.imStart = get("imStart", job.imStart);
+    job.imEnd = get("imEnd", job.imEnd);
+    job.precision = get("precision", job.precision);
+    job.output = get("output", job.output);
+    if (job.reStart.empty() || job.reEnd.empty() || job.imStart.empty() || job.imEnd.empty() || job.output.empty()) {
+        job.error = "viewport or output missing";
+    }
+    // A bad number only invalidates its own entry
+    try {
+        job.maxIter = stoi(get("maxIter", to_string(job.maxIter)));
+        job.paletteLength = stoi(get("paletteLength", to_string(job.paletteLength)));
+        job.paletteId = stoi(get("paletteId", to_string(job.paletteId)));
+        job.width = stoi(get("width", to_string(job.width)));
+        job.height = stoi(get("height", to_string(job.height)));
+    }
+    catch (const exception& e) {
+        job.error = "maxIter, paletteLength, paletteId, width or height is not a number";
+    }
+    return job;
+}
+
+vector<BatchJob> readBatchJobsCsv(istream& in) {
+    vector<BatchJob> jobs;
+    string line;
+    if (!getline(in, line)) {
+        return jobs;
+    }
+    vector<string> header = splitCsvLine(line);
+    while (getline(in, line)) {
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        vector<string> fields = splitCsvLine(line);
+        jobs.push_back(makeBatchJob([&](const char* name, const string& fallback) {
+            for (size_t i = 0; i < header.size() && i < fields.size(); i++) {
+                if (header[i] == name && !fields[i].empty()) {
+                    return fields[i];
+                }
+            }
+            return fallback;
+        }));
+    }
+    return jobs;
+}
+
+vector<BatchJob> readBatchJobsJson(istream& in) {
+    boost::property_tree::ptree root;
+    boost::property_tree::read_json(in, root);
+    vector<BatchJob> jobs;
+    for (const auto& entry : root) {
+        const boost::property_tree::ptree& fields = entry.second;
+        jobs.push_back(makeBatchJob([&](const char* name, const string& fallback) {
+            return fields.get<string>(name, fallback);
+        }));
+    }
+    return jobs;
+}
+
+vector<BatchJob> readBatchManifest(const string& fileName) {
+    ifstream in(fileName);
+    if (!in) {
+        cerr << "Could not open " << fileName << endl;
+        return {};
+    }
+    try {
+        return endsWith(fileName, ".csv") ? readBatchJobsCsv(in) : readBatchJobsJson(in);
+    }
+    catch (const exception& e) {
+        cerr << "Could not read " << fileName << ": " << e.what() << endl;
+        return {};
+    }
+}
+
+string batchJobHash(const BatchJob& job, const string& renderSettings) {
+    stringstream parameters;
+    parameters << job.reStart << "|" << job.reEnd << "|" << job.imStart << "|" << job.imEnd << "|" << job.precision << "|"
+        << job.maxIter << "|" << job.paletteLength << "|" << job.paletteId << "|" << job.width << "|" << job.height << "|"
+        << renderSettings;
+    unsigned long long hash = 14695981039346656037ull;
+    for (char c : parameters.str()) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    stringstream hex;
+    hex << std::hex << setw(16) << setfill('0') << hash;
+    return hex.str();
+}
+
+const char* batchJobStatusName(BatchJobStatus status) {
+    switch (status) {
+    case BATCH_JOB_SKIPPED:
+        return "skipped";
+    case BATCH_JOB_INVALID:
+        return "invalid";
+    default:
+        return "rendered";
+    }
+}
+
+void writeBatchReportJson(const vector<BatchJobResult>& results, ostream& out) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BatchJobResult& result = results[i];
+        out << "  {\n";
+        out << "    \"output\": \"" << result.job.output << "\",\n";
+        out << "    \"status\": \"" << batchJobStatusName(result.status) << "\",\n";
+        out << "    \"precision\": \"" << result.job.precision << "\",\n";
+        out << "    \"width\": " << result.job.width << ",\n";
+        out << "    \"height\": " << result.job.height << ",\n";
+        out << "    \"maxIter\": " << result.job.maxIter << ",\n";
+        out << "    \"totalIterations\": " << result.stats.totalIterations << ",\n";
+        out << "    \"phasesMs\": { "
+            << "\"mapping\": " << result.stats.mappingMs << ", "
+            << "\"iteration\": " << result.stats.iterationMs << ", "
+            << "\"coloring\": " << result.stats.coloringMs << ", "
+            << "\"image\": " << result.stats.imageMs << ", "
+            << "\"render\": " << result.stats.totalMs << ", "
+            << "\"write\": " << result.writeMs << " }\n";
+        out << "  }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+void writeBatchReportCsv(const vector<BatchJobResult>& results, ostream& out) {
+    out << "output,status,precision,width,height,maxIter,totalIterations,mappingMs,iterationMs,coloringMs,imageMs,renderMs,writeMs\n";
+    for (const BatchJobResult& result : results) {
+        out << "\"" << result.job.output << "\"," << batchJobStatusName(result.status) << "," << result.job.precision << ","
+            << result.job.width << "," << result.job.height << "," << result.job.maxIter << "," << result.stats.totalIterations << ","
+            << result.stats.mappingMs << "," << result.stats.iterationMs << "," << result.stats.coloringMs << ","
+            << result.stats.imageMs << "," << result.stats.totalMs << "," << result.writeMs << "\n";
+    }
+}
+
+void writeBatchReport(const vector<BatchJobResult>& results, const string& fileName) {
+    ofstream out(fileName);
+    if (!out) {
+        cerr << "Could not open " << fileName << " for writing\n";
+        return;
+    }
+    if (endsWith(fileName, ".csv")) {
+        writeBatchReportCsv(results, out);
+    }
+    else {
+        writeBatchReportJson(results, out);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef BATCH_JOBS_H
+#define BATCH_JOBS_H
+
+#include <string>
+#include <vector>
+
+#include "RenderStats.h"
+
+using namespace std;
+
+// One render of a batch manifest. The viewport is kept as text so deep zooms keep every digit.
+struct BatchJob {
+    string reStart;
+    string reEnd;
+    string imStart;
+    string imEnd;
+    string precision = "auto";  // a precision name or its command line number
+    int maxIter = 400;
+    int paletteLength = 256;
+    int paletteId = 0;
+    int width = 900;
+    int height = 600;
+    string output;
+    string error;               // why the manifest entry cannot be rendered, empty for valid jobs
+};
+
+enum BatchJobStatus {
+    BATCH_JOB_RENDERED,
+    BATCH_JOB_SKIPPED,          // the output already existed with the same parameter hash
+    BATCH_JOB_INVALID           // rejected for invalid parameters or viewport, nothing was rendered
+};
+
+struct BatchJobResult {
+    BatchJob job;
+    BatchJobStatus status;
+    RenderStats stats;
+    double writeMs;
+};
+
+// Reads a JSON array of job objects, or a CSV file with a header row when the name ends in .csv.
+// Fields are named like the BatchJob members, missing ones keep their defaults. Every entry is
+// returned, those without a viewport or output or with a non-numeric number field carry an error.
+vector<BatchJob> readBatchManifest(const string& fileName);
+// FNV-1a hash of the job parameters and the render settings shared by the whole batch, as 16 hex digits
+string batchJobHash(const BatchJob& job, const string& renderSettings);
+// Per job phase times, .csv or anything else for JSON, like the benchmark results
+void writeBatchReport(const vector<BatchJobResult>& results, const string& fileName);
+#endif
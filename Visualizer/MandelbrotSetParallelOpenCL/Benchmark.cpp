@@ -0,0 +1,123 @@
+#include <Benchmark.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+struct PhaseSummary {
+    double median;
+    double p10;
+    double p90;
+    double min;
+    double max;
+};
+
+// Linear interpolation between the closest ranks
+double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    double rank = p * (sorted.size() - 1);
+    size_t lower = (size_t)rank;
+    size_t upper = min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
+PhaseSummary summarize(const vector<RenderStats>& runs, double RenderStats::* phase) {
+    vector<double> values;
+    for (const RenderStats& run : runs) {
+        values.push_back(run.*phase);
+    }
+    sort(values.begin(), values.end());
+    return { percentile(values, 0.5), percentile(values, 0.1), percentile(values, 0.9), values.front(), values.back() };
+}
+
+const vector<pair<const char*, double RenderStats::*>> PHASES = {
+    { "mapping", &RenderStats::mappingMs },
+    { "iteration", &RenderStats::iterationMs },
+    { "coloring", &RenderStats::coloringMs },
+    { "image", &RenderStats::imageMs },
+    { "total", &RenderStats::totalMs },
+    { "device-setup", &RenderStats::setupMs },
+    { "program-build", &RenderStats::buildMs },
+    { "transfer", &RenderStats::transferMs },
+    { "kernel", &RenderStats::kernelMs },
+    { "allocation", &RenderStats::allocationMs }
+};
+
+// Throughput is taken from the median iteration and total times
+double megaIterationsPerSecond(const BenchmarkResult& result) {
+    double iterationMs = summarize(result.runs, &RenderStats::iterationMs).median;
+    return iterationMs > 0 ? result.runs.front().totalIterations / (iterationMs * 1000.0) : 0;
+}
+
+double pixelsPerSecond(const BenchmarkResult& result) {
+    double totalMs = summarize(result.runs, &RenderStats::totalMs).median;
+    return totalMs > 0 ? result.runs.front().pixels / (totalMs / 1000.0) : 0;
+}
+
+void writeBenchmarkJson(const vector<BenchmarkResult>& results, ostream& out) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        out << "  {\n";
+        out << "    \"viewport\": \"" << result.viewport << "\",\n";
+        out << "    \"precision\": \"" << result.precision << "\",\n";
+        out << "    \"device\": \"" << result.device << "\",\n";
+        out << "    \"width\": " << result.width << ",\n";
+        out << "    \"height\": " << result.height << ",\n";
+        out << "    \"maxIter\": " << result.maxIter << ",\n";
+        out << "    \"runs\": " << result.runs.size() << ",\n";
+        out << "    \"totalIterations\": " << result.runs.front().totalIterations << ",\n";
+        out << "    \"mIterationsPerSecond\": " << megaIterationsPerSecond(result) << ",\n";
+        out << "    \"pixelsPerSecond\": " << pixelsPerSecond(result) << ",\n";
+        out << "    \"phasesMs\": {\n";
+        for (size_t j = 0; j < PHASES.size(); j++) {
+            PhaseSummary summary = summarize(result.runs, PHASES[j].second);
+            out << "      \"" << PHASES[j].first << "\": { "
+                << "\"median\": " << summary.median << ", "
+                << "\"p10\": " << summary.p10 << ", "
+                << "\"p90\": " << summary.p90 << ", "
+                << "\"min\": " << summary.min << ", "
+                << "\"max\": " << summary.max << " }"
+                << (j + 1 < PHASES.size() ? "," : "") << "\n";
+        }
+        out << "    }\n";
+        out << "  }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+void writeBenchmarkCsv(const vector<BenchmarkResult>& results, ostream& out) {
+    out << "viewport,precision,device,width,height,maxIter,runs,totalIterations,mIterationsPerSecond,pixelsPerSecond";
+    for (const auto& phase : PHASES) {
+        out << "," << phase.first << "MedianMs," << phase.first << "P10Ms," << phase.first << "P90Ms";
+    }
+    out << "\n";
+    for (const BenchmarkResult& result : results) {
+        out << result.viewport << "," << result.precision << ",\"" << result.device << "\","
+            << result.width << "," << result.height << "," << result.maxIter << ","
+            << result.runs.size() << "," << result.runs.front().totalIterations << ","
+            << megaIterationsPerSecond(result) << "," << pixelsPerSecond(result);
+        for (const auto& phase : PHASES) {
+            PhaseSummary summary = summarize(result.runs, phase.second);
+            out << "," << summary.median << "," << summary.p10 << "," << summary.p90;
+        }
+        out << "\n";
+    }
+}
+
+void writeBenchmarkResults(const vector<BenchmarkResult>& results, const string& fileName) {
+    ofstream out(fileName);
+    if (!out) {
+        cerr << "Could not open " << fileName << " for writing\n";
+        return;
+    }
+    bool csv = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        writeBenchmarkCsv(results, out);
+    }
+    else {
+        writeBenchmarkJson(results, out);
+    }
+}
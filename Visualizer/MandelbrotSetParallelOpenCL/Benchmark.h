@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+#include "RenderStats.h"
+
+using namespace std;
+
+// All runs of one viewport rendered with one precision on one device
+struct BenchmarkResult {
+    string viewport;
+    string precision;
+    string device;
+    int width;
+    int height;
+    int maxIter;
+    vector<RenderStats> runs;
+};
+
+// Writes median and percentile phase times plus throughput for every result.
+// The format is picked from the file extension, .csv or anything else for JSON.
+void writeBenchmarkResults(const vector<BenchmarkResult>& results, const string& fileName);
+#endif
@@ -1,7 +1,12 @@
 #include <ColorManager.h>
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
+#include "FrameArena.h"
+#include "ThreadPlacement.h"
+
 #define PI 3.14159265358979323846
 
 CyclicColorPalette::CyclicColorPalette(int imageSize, vector<Color> colors, int length) : ColorManager(imageSize) {
@@ -35,20 +40,21 @@ Color getColorFromPalette(int val, vector<Color>& colors, double length) {
     return output;
 }
 
-void CyclicColorPalette::paint(int* iters, Color pixels[]) {
-    #pragma omp parallel for
-    for (int i = 0; i < this->imageSize; i++) {
-        if (iters[i] == -1) {
-            Color black{};
-            black.red = 0;
-            black.green = 0;
-            black.blue = 0;
-            pixels[i] = black;
+void CyclicColorPalette::paint(int* iters, Color pixels[], int count) {
+    parallelStaticTimed("Coloring pixels", count, [&](long long begin, long long end) {
+        for (long long i = begin; i < end; i++) {
+            if (iters[i] == -1) {
+                Color black{};
+                black.red = 0;
+                black.green = 0;
+                black.blue = 0;
+                pixels[i] = black;
+            }
+            else {
+                pixels[i] = getColorFromPalette(iters[i], this->colors, this->length);
+            }
         }
-        else {
-            pixels[i] = getColorFromPalette(iters[i], this->colors, this->length);
-        }
-    }
+    });
 }
 
 HistogramColorPalette::HistogramColorPalette(int imageSize, int maxIter, vector<Color> colors) : ColorManager(imageSize) {
@@ -64,19 +70,20 @@ Color HistogramColorPalette::interpolateColor(Color& lCol, Color& rCol, double v
     return Color{ r,g,b };
 }
 
-void HistogramColorPalette::paint(int* iters, Color pixels[]) {
-    vector<int> numItersPerPixel(this->maxIter + 1, 0);
+void HistogramColorPalette::paint(int* iters, Color pixels[], int count) {
+    int* numItersPerPixel = frameArena().allocate<int>(this->maxIter + 1);
+    fill(numItersPerPixel, numItersPerPixel + this->maxIter + 1, 0);
     #pragma omp parallel for
-    for (int i = 0; i < this->imageSize; i++) {
+    for (int i = 0; i < count; i++) {
         int val = iters[i] == -1 ? this->maxIter : iters[i];
+        #pragma omp atomic
         numItersPerPixel[val]++;
     }
-    vector<double> hues(this->imageSize, 0);
     #pragma omp parallel for
-    for (int i = 0; i < this->imageSize; i++) {
+    for (int i = 0; i < count; i++) {
         double hue = 0;
         for (int j = 0; j < iters[i]; j++) {
-            hue += numItersPerPixel[j] * 1.0 / this->imageSize;
+            hue += numItersPerPixel[j] * 1.0 / count;
         }
         Color c1{ 7,6,38 };
         Color c2{ 140, 143, 213 };
@@ -140,7 +147,7 @@ void LAB2RGB(int L, int a, int b, unsigned char& R, unsigned char& G, unsigned c
     //printf("Lab=(%f,%f,%f) ==> RGB(%f,%f,%f)\n",L,a,b,*R,*G,*B);
 }
 
-void ExponentialColorPalette::paint(int* iters, Color pixels[]) {
+void ExponentialColorPalette::paint(int* iters, Color pixels[], int count) {
     const double S = 2.0;      // exponent
     //#pragma omp parallel for
     //for (int i = 0; i < this->imageSize; i++) {
@@ -164,4 +171,52 @@ void ExponentialColorPalette::paint(int* iters, Color pixels[]) {
 
     //    pixels[i] = Color{ R, G, B };
     //}
-}
\ No newline at end of file
+}
+
+double srgbToLinear(unsigned char value) {
+    double v = value / 255.0;
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+unsigned char linearToSrgb(double value) {
+    double v = value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+    return (unsigned char)(min(max(v, 0.0), 1.0) * 255.0 + 0.5);
+}
+
+void accumulateLinear(const Color& color, double sum[3]) {
+    sum[0] += srgbToLinear(color.red);
+    sum[1] += srgbToLinear(color.green);
+    sum[2] += srgbToLinear(color.blue);
+}
+
+Color averageLinear(const double sum[3], int count) {
+    return Color{ linearToSrgb(sum[0] / count), linearToSrgb(sum[1] / count), linearToSrgb(sum[2] / count) };
+}
+
+void paintDistances(const float* distances, Color pixels[], int count, const vector<Color>& colors, float boundaryWidth) {
+    // Cyclic palettes repeat their first colour at the end, which would make the far exterior look like the boundary
+    int segments = (int)colors.size() - 1;
+    const Color& first = colors.front();
+    const Color& last = colors.back();
+    if (segments > 1 && first.red == last.red && first.green == last.green && first.blue == last.blue) {
+        segments--;
+    }
+    #pragma omp parallel for
+    for (int i = 0; i < count; i++) {
+        if (distances[i] <= 0) {
+            pixels[i] = Color{ 0, 0, 0 };
+            continue;
+        }
+        // The square root widens the dark edge, so filaments thinner than a pixel stay visible
+        double position = sqrt(min(distances[i] / boundaryWidth, 1.0f)) * segments;
+        int index = min((int)position, segments - 1);
+        double fraction = position - index;
+        const Color& l = colors[index];
+        const Color& r = colors[index + 1];
+        pixels[i] = Color{
+            (unsigned char)(l.red + (r.red - l.red) * fraction),
+            (unsigned char)(l.green + (r.green - l.green) * fraction),
+            (unsigned char)(l.blue + (r.blue - l.blue) * fraction)
+        };
+    }
+}
@@ -15,7 +15,12 @@ struct Color {
 
 class ColorManager {
 public:
-    virtual void paint(int* iters, Color pixels[]) = 0;
+    void paint(int* iters, Color pixels[]) {
+        paint(iters, pixels, this->imageSize);
+    }
+    // Paints the first count values, more than imageSize when extra anti-aliasing samples follow the image
+    virtual void paint(int* iters, Color pixels[], int count) = 0;
+    virtual ~ColorManager() {}
 protected:
     ColorManager(int imageSize) {
         this->imageSize = imageSize;
@@ -26,7 +31,8 @@ protected:
 class CyclicColorPalette : public ColorManager {
 public:
     CyclicColorPalette(int imageSize, vector<Color> colors, int length);
-    void paint(int* iters, Color pixels[]) override;
+    using ColorManager::paint;
+    void paint(int* iters, Color pixels[], int count) override;
 
 private:
     vector<Color> colors;
@@ -36,7 +42,8 @@ private:
 class HistogramColorPalette : public ColorManager {
 public:
     HistogramColorPalette(int imageSize, int maxIter, vector<Color> colors);
-    void paint(int* iters, Color pixels[]) override;
+    using ColorManager::paint;
+    void paint(int* iters, Color pixels[], int count) override;
 private:
     Color interpolateColor(Color& l, Color& r, double val);
     int maxIter;
@@ -46,10 +53,19 @@ private:
 class ExponentialColorPalette : public ColorManager {
 public:
     ExponentialColorPalette(int imageSize, int maxIter, vector<Color> colors, int length);
-    void paint(int* iters, Color pixels[]) override;
+    using ColorManager::paint;
+    void paint(int* iters, Color pixels[], int count) override;
 private:
     int maxIter;
     vector<Color> colors;
     double length;
 };
+
+// Colours exterior distance estimates in pixels, the palette runs from the boundary out to boundaryWidth pixels
+// and farther pixels take its last colour. Points in the set (distance 0) are black.
+void paintDistances(const float* distances, Color pixels[], int count, const vector<Color>& colors, float boundaryWidth);
+
+// Samples are averaged in linear light, averaging sRGB values directly darkens the edges
+void accumulateLinear(const Color& color, double sum[3]);
+Color averageLinear(const double sum[3], int count);
 #endif
\ No newline at end of file
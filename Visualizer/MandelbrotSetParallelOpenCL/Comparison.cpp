@@ -0,0 +1,104 @@
+#include <Comparison.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+void compareIterations(const int* reference, const int* iters, int tolerance, double maxMismatchFraction, ComparisonResult& result) {
+    long long size = (long long)result.width * result.height;
+    long long mismatched = 0;
+    long long beyondTolerance = 0;
+    long long escapeFlips = 0;
+    int maxDifference = 0;
+    for (long long i = 0; i < size; i++) {
+        if (reference[i] == iters[i]) {
+            continue;
+        }
+        mismatched++;
+        // -1 marks points that did not escape
+        if (reference[i] == -1 || iters[i] == -1) {
+            escapeFlips++;
+            beyondTolerance++;
+            continue;
+        }
+        int difference = abs(reference[i] - iters[i]);
+        maxDifference = max(maxDifference, difference);
+        if (difference > tolerance) {
+            beyondTolerance++;
+        }
+    }
+    result.mismatched = mismatched;
+    result.beyondTolerance = beyondTolerance;
+    result.escapeFlips = escapeFlips;
+    result.maxDifference = maxDifference;
+    result.passed = beyondTolerance <= maxMismatchFraction * size;
+}
+
+void printComparisonResults(const vector<ComparisonResult>& results) {
+    // Later output keeps the stream's formatting
+    ios::fmtflags flags = cout.flags();
+    streamsize precision = cout.precision();
+    cout << "\n" << left << setw(18) << "viewport" << setw(18) << "backend" << setw(18) << "reference"
+        << right << setw(10) << "mismatch" << setw(10) << "beyond" << setw(8) << "flips" << setw(8) << "maxDiff"
+        << setw(12) << "iter ms" << "  result  device\n";
+    for (const ComparisonResult& result : results) {
+        cout << left << setw(18) << result.viewport << setw(18) << result.backend << setw(18) << result.reference
+            << right << setw(10) << result.mismatched << setw(10) << result.beyondTolerance << setw(8) << result.escapeFlips
+            << setw(8) << result.maxDifference << setw(12) << fixed << setprecision(1) << result.iterationMs
+            << (result.passed ? "  pass    " : "  FAIL    ") << result.device << "\n";
+    }
+    cout.flags(flags);
+    cout.precision(precision);
+}
+
+void writeComparisonJson(const vector<ComparisonResult>& results, ostream& out) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const ComparisonResult& result = results[i];
+        out << "  {\n";
+        out << "    \"viewport\": \"" << result.viewport << "\",\n";
+        out << "    \"backend\": \"" << result.backend << "\",\n";
+        out << "    \"reference\": \"" << result.reference << "\",\n";
+        out << "    \"device\": \"" << result.device << "\",\n";
+        out << "    \"width\": " << result.width << ",\n";
+        out << "    \"height\": " << result.height << ",\n";
+        out << "    \"maxIter\": " << result.maxIter << ",\n";
+        out << "    \"mismatched\": " << result.mismatched << ",\n";
+        out << "    \"beyondTolerance\": " << result.beyondTolerance << ",\n";
+        out << "    \"escapeFlips\": " << result.escapeFlips << ",\n";
+        out << "    \"maxDifference\": " << result.maxDifference << ",\n";
+        out << "    \"iterationMs\": " << result.iterationMs << ",\n";
+        out << "    \"totalMs\": " << result.totalMs << ",\n";
+        out << "    \"passed\": " << (result.passed ? "true" : "false") << "\n";
+        out << "  }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+void writeComparisonCsv(const vector<ComparisonResult>& results, ostream& out) {
+    out << "viewport,backend,reference,device,width,height,maxIter,mismatched,beyondTolerance,escapeFlips,maxDifference,"
+        << "iterationMs,totalMs,passed\n";
+    for (const ComparisonResult& result : results) {
+        out << result.viewport << "," << result.backend << "," << result.reference << ",\"" << result.device << "\","
+            << result.width << "," << result.height << "," << result.maxIter << ","
+            << result.mismatched << "," << result.beyondTolerance << "," << result.escapeFlips << "," << result.maxDifference << ","
+            << result.iterationMs << "," << result.totalMs << "," << (result.passed ? 1 : 0) << "\n";
+    }
+}
+
+void writeComparisonResults(const vector<ComparisonResult>& results, const string& fileName) {
+    ofstream out(fileName);
+    if (!out) {
+        cerr << "Could not open " << fileName << " for writing\n";
+        return;
+    }
+    bool csv = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        writeComparisonCsv(results, out);
+    }
+    else {
+        writeComparisonJson(results, out);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef COMPARISON_H
+#define COMPARISON_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Escape iterations of one backend diffed against the reference backend of a viewport
+struct ComparisonResult {
+    string viewport;
+    string backend;
+    string reference;
+    string device;                      // empty for host backends
+    int width;
+    int height;
+    int maxIter;
+    long long mismatched = 0;           // pixels with any difference
+    long long beyondTolerance = 0;      // pixels differing by more than the tolerance, escape flips included
+    long long escapeFlips = 0;          // pixels escaping in only one of the two
+    int maxDifference = 0;              // largest difference of pixels escaping in both
+    double iterationMs = 0;
+    double totalMs = 0;
+    bool passed = false;
+};
+
+// Fills the difference counts of result, which must hold the image size. The backend passes when at most
+// maxMismatchFraction of the pixels are beyond the tolerance.
+void compareIterations(const int* reference, const int* iters, int tolerance, double maxMismatchFraction, ComparisonResult& result);
+void printComparisonResults(const vector<ComparisonResult>& results);
+// The format is picked from the file extension like writeBenchmarkResults, .csv or anything else for JSON
+void writeComparisonResults(const vector<ComparisonResult>& results, const string& fileName);
+#endif
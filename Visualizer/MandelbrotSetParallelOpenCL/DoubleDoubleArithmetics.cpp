@@ -0,0 +1,57 @@
+#include <DoubleDoubleArithmetics.h>
+
+#include <cmath>
+
+using namespace std;
+
+namespace dda {
+	void twoSum(double a, double b, double c[DD_SIZE]) {
+		double s = a + b;
+		double bb = s - a;
+		c[1] = (a - (s - bb)) + (b - bb);
+		c[0] = s;
+	}
+
+	// Only valid when |a| >= |b|
+	void quickTwoSum(double a, double b, double c[DD_SIZE]) {
+		double s = a + b;
+		c[1] = b - (s - a);
+		c[0] = s;
+	}
+
+	void twoProd(double a, double b, double c[DD_SIZE]) {
+		double p = a * b;
+		c[1] = fma(a, b, -p);
+		c[0] = p;
+	}
+
+	void addDD(const double* a, const double* b, double c[DD_SIZE]) {
+		double s[DD_SIZE];
+		double t[DD_SIZE];
+		twoSum(a[0], b[0], s);
+		twoSum(a[1], b[1], t);
+		s[1] += t[0];
+		quickTwoSum(s[0], s[1], s);
+		s[1] += t[1];
+		quickTwoSum(s[0], s[1], c);
+	}
+
+	void subDD(const double* a, const double* b, double c[DD_SIZE]) {
+		double negB[DD_SIZE] = { -b[0], -b[1] };
+		addDD(a, negB, c);
+	}
+
+	void mulDD(const double* a, const double* b, double c[DD_SIZE]) {
+		double p[DD_SIZE];
+		twoProd(a[0], b[0], p);
+		p[1] = fma(a[0], b[1], fma(a[1], b[0], p[1]));
+		quickTwoSum(p[0], p[1], c);
+	}
+
+	void mulDoubleDD(const double* a, double b, double c[DD_SIZE]) {
+		double p[DD_SIZE];
+		twoProd(a[0], b, p);
+		p[1] = fma(a[1], b, p[1]);
+		quickTwoSum(p[0], p[1], c);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+namespace dda {
+
+	// A double-double number is stored as two doubles, the high part first,
+	// and represents their unevaluated sum (about 106 bits of mantissa)
+	constexpr int DD_SIZE = 2;
+
+	// Error-free transforms
+	void twoSum(double a, double b, double c[DD_SIZE]);
+	void quickTwoSum(double a, double b, double c[DD_SIZE]);
+	void twoProd(double a, double b, double c[DD_SIZE]);
+
+	// Function declarations
+	void addDD(const double* a, const double* b, double c[DD_SIZE]);
+	void subDD(const double* a, const double* b, double c[DD_SIZE]);
+	void mulDD(const double* a, const double* b, double c[DD_SIZE]);
+	void mulDoubleDD(const double* a, double b, double c[DD_SIZE]);
+
+} // namespace dda
+
+#endif // DOUBLE_DOUBLE_H
@@ -0,0 +1,15 @@
+#include <FloatExp.h>
+
+#include <cmath>
+
+using namespace std;
+
+namespace fea {
+	FloatExp makeFE(double mantissa, int exponent) {
+		int shift;
+		FloatExp result;
+		result.mantissa = frexp(mantissa, &shift);
+		result.exponent = exponent + shift;
+		return result;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef FLOAT_EXP_H
+#define FLOAT_EXP_H
+
+// Extended-exponent floating point number, value = mantissa * 2^exponent.
+// The mantissa is kept in [0.5, 1) so values far below the range of a double
+// (perturbation deltas past 1e-308) can still be represented.
+// Layout matches the FloatExp struct in kernelPT.cl.
+struct FloatExp {
+	double mantissa;
+	int exponent;
+};
+
+namespace fea {
+
+	// Function declarations
+	// Normalizes mantissa * 2^exponent, the arithmetic lives in kernelPT.cl
+	FloatExp makeFE(double mantissa, int exponent);
+
+} // namespace fea
+
+#endif // FLOAT_EXP_H
@@ -0,0 +1,119 @@
+#include <Formula.h>
+
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+bool parsePower(const string& text, int& power) {
+    try {
+        size_t used;
+        power = stoi(text, &used);
+        return used == text.size() && power >= 2 && power <= MAX_FORMULA_POWER;
+    }
+    catch (const exception& e) {
+        return false;
+    }
+}
+
+bool parseFormula(const string& text, Formula& formula) {
+    formula = Formula();
+    size_t colon = text.find(':');
+    string name = text.substr(0, colon);
+    string parameters = colon == string::npos ? "" : text.substr(colon + 1);
+    if (name == "mandelbrot") {
+        return parameters.empty();
+    }
+    if (name == "multibrot") {
+        return parsePower(parameters, formula.power);
+    }
+    if (name == "burning-ship") {
+        formula.burningShip = true;
+        return parameters.empty() || parsePower(parameters, formula.power);
+    }
+    if (name != "julia") {
+        return false;
+    }
+    formula.julia = true;
+    vector<string> values;
+    stringstream list(parameters);
+    string value;
+    while (getline(list, value, ',')) {
+        values.push_back(value);
+    }
+    if (values.size() < 2 || values.size() > 3) {
+        return false;
+    }
+    try {
+        formula.juliaReal = stod(values[0]);
+        formula.juliaImag = stod(values[1]);
+    }
+    catch (const exception& e) {
+        return false;
+    }
+    return values.size() == 2 || parsePower(values[2], formula.power);
+}
+
+string formulaName(const Formula& formula) {
+    stringstream name;
+    name << setprecision(17);
+    if (formula.julia) {
+        name << "julia:" << formula.juliaReal << "," << formula.juliaImag;
+        if (formula.power != 2) {
+            name << "," << formula.power;
+        }
+    }
+    else if (formula.burningShip) {
+        name << "burning-ship";
+        if (formula.power != 2) {
+            name << ":" << formula.power;
+        }
+    }
+    else if (formula.power != 2) {
+        name << "multibrot:" << formula.power;
+    }
+    else {
+        name << "mandelbrot";
+    }
+    return name.str();
+}
+
+bool isMandelbrot(const Formula& formula) {
+    return formula.power == 2 && !formula.julia && !formula.burningShip;
+}
+
+string formulaBuildOptions(const Formula& formula) {
+    stringstream options;
+    options << setprecision(17);
+    if (formula.power != 2) {
+        options << " -D FORMULA_POWER=" << formula.power;
+    }
+    if (formula.burningShip) {
+        options << " -D FORMULA_BURNING_SHIP";
+    }
+    if (formula.julia) {
+        options << " -D FORMULA_JULIA -D JULIA_RE=" << formula.juliaReal << " -D JULIA_IM=" << formula.juliaImag;
+    }
+    string result = options.str();
+    return result.empty() ? result : result.substr(1);
+}
+
+typedef int (*FormulaIterator)(double x, double y, double cx, double cy, int maxIter);
+
+// Indexed by power - 2, plain and Burning Ship
+const FormulaIterator FORMULA_ITERATORS[MAX_FORMULA_POWER - 1][2] = {
+    { iterateFormula<2, false>, iterateFormula<2, true> },
+    { iterateFormula<3, false>, iterateFormula<3, true> },
+    { iterateFormula<4, false>, iterateFormula<4, true> },
+    { iterateFormula<5, false>, iterateFormula<5, true> },
+    { iterateFormula<6, false>, iterateFormula<6, true> },
+    { iterateFormula<7, false>, iterateFormula<7, true> },
+    { iterateFormula<8, false>, iterateFormula<8, true> }
+};
+
+int iterateFormulaPoint(const Formula& formula, double real, double imag, int maxIter) {
+    FormulaIterator iterate = FORMULA_ITERATORS[formula.power - 2][formula.burningShip ? 1 : 0];
+    if (formula.julia) {
+        return iterate(real, imag, formula.juliaReal, formula.juliaImag, maxIter);
+    }
+    return iterate(0, 0, real, imag, maxIter);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+// Highest exponent with a CPU instantiation, the kernel takes any power as a build option
+#define MAX_FORMULA_POWER 8
+
+// Escape-time formula z -> z^power + c. Julia sets iterate from the pixel with a fixed c,
+// the Burning Ship takes the absolute values of both parts of z before raising it.
+struct Formula {
+    int power = 2;
+    bool julia = false;
+    bool burningShip = false;
+    double juliaReal = 0;
+    double juliaImag = 0;
+};
+
+// Accepts mandelbrot, multibrot:D, burning-ship[:D] and julia:RE,IM[,D]
+bool parseFormula(const string& text, Formula& formula);
+string formulaName(const Formula& formula);
+bool isMandelbrot(const Formula& formula);
+// -D options specializing kernel.cl, empty for the Mandelbrot set so its program stays the default build
+string formulaBuildOptions(const Formula& formula);
+
+// Same loop as the specialized kernel, the power is unrolled and the x2, y2 form kept for squares
+template<int Power, bool BurningShip>
+int iterateFormula(double x, double y, double cx, double cy, int maxIter) {
+    double x2 = x * x;
+    double y2 = y * y;
+    for (int i = 0; i < maxIter; i++) {
+        if (Power == 2) {
+            y = (BurningShip ? 2 * fabs(x * y) : (x + x) * y) + cy;
+            x = x2 - y2 + cx;
+        }
+        else {
+            double zr = BurningShip ? fabs(x) : x;
+            double zi = BurningShip ? fabs(y) : y;
+            double pr = zr;
+            double pi = zi;
+            for (int p = 1; p < Power; p++) {
+                double t = pr * zr - pi * zi;
+                pi = pr * zi + pi * zr;
+                pr = t;
+            }
+            x = pr + cx;
+            y = pi + cy;
+        }
+        x2 = x * x;
+        y2 = y * y;
+        if (x2 + y2 > 4) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Escape iteration of a pixel, -1 when it did not escape, the power is limited to MAX_FORMULA_POWER
+int iterateFormulaPoint(const Formula& formula, double real, double imag, int maxIter);
+#endif
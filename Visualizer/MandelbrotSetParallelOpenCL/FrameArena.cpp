@@ -0,0 +1,148 @@
+#include <FrameArena.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "ThreadPlacement.h"
+
+using namespace std;
+
+// New blocks are at least this large, so small frames do not grow the arena one buffer at a time
+const size_t MIN_BLOCK_SIZE = 16 << 20;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameArena::~FrameArena() {
+    for (const Block& block : blocks) {
+        freeBlock(block);
+    }
+}
+
+void FrameArena::reset() {
+    auto start = chrono::high_resolution_clock::now();
+    allocationMs = 0;
+    if (blocks.size() > 1) {
+        // The last frame fits into the sum of what it used, each buffer is already aligned
+        size_t total = 0;
+        for (const Block& block : blocks) {
+            total += block.used;
+            freeBlock(block);
+        }
+        blocks.clear();
+        blocks.push_back(allocateBlock(max(total, MIN_BLOCK_SIZE)));
+        allocationMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+    for (Block& block : blocks) {
+        block.used = 0;
+    }
+    current = 0;
+}
+
+double FrameArena::getAllocationMs() const {
+    return allocationMs;
+}
+
+size_t FrameArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block& block : blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void FrameArena::setHugePages(bool enabled) {
+    hugePages = enabled;
+}
+
+void* FrameArena::allocateBytes(size_t bytes) {
+    auto start = chrono::high_resolution_clock::now();
+    bytes = alignUp(max(bytes, (size_t)1), CACHE_LINE_SIZE);
+    while (current < blocks.size() && blocks[current].size - blocks[current].used < bytes) {
+        current++;
+    }
+    if (current == blocks.size()) {
+        blocks.push_back(allocateBlock(max(bytes, MIN_BLOCK_SIZE)));
+    }
+    Block& block = blocks[current];
+    char* data = block.data + block.used;
+    block.used += bytes;
+
+    // Pages are first touched with the static partition of the buffer, the same ranges the OpenMP loops
+    // over the buffer give each thread, so on NUMA systems every thread works on memory of its own node
+    if (block.used > block.touched) {
+        size_t offset = data - block.data;
+        long long touchedPrefix = block.touched > offset ? block.touched - offset : 0;
+        parallelStatic(bytes, [&](long long begin, long long end) {
+            begin = max(begin, touchedPrefix);
+            if (begin < end) {
+                memset(data + begin, 0, end - begin);
+            }
+        });
+        block.touched = block.used;
+        allocationMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+    return data;
+}
+
+// Page aligned memory straight from the system, its pages are touched as buffers are handed out
+FrameArena::Block FrameArena::allocateBlock(size_t bytes) {
+    Block block = { nullptr, bytes, 0, 0, false };
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t pageSize = info.dwPageSize;
+    size_t largePageSize = GetLargePageMinimum();
+    if (hugePages && largePageSize > 0) {
+        // Needs the "Lock pages in memory" privilege, without it the normal allocation below is used
+        size_t size = alignUp(bytes, largePageSize);
+        block.data = (char*)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (block.data != nullptr) {
+            block.size = size;
+            block.hugePages = true;
+        }
+    }
+    if (block.data == nullptr) {
+        block.size = alignUp(bytes, pageSize);
+        block.data = (char*)VirtualAlloc(NULL, block.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+#else
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    block.size = alignUp(bytes, hugePages ? 2 << 20 : pageSize);
+    void* data = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data != MAP_FAILED) {
+        block.data = (char*)data;
+#ifdef MADV_HUGEPAGE
+        block.hugePages = hugePages && madvise(data, block.size, MADV_HUGEPAGE) == 0;
+#endif
+    }
+#endif
+    if (block.data == nullptr) {
+        cerr << "Frame arena could not allocate " << bytes << " bytes" << endl;
+        exit(1);
+    }
+    return block;
+}
+
+void FrameArena::freeBlock(const Block& block) {
+#ifdef _WIN32
+    VirtualFree(block.data, 0, MEM_RELEASE);
+#else
+    munmap(block.data, block.size);
+#endif
+}
+
+FrameArena& frameArena() {
+    static FrameArena arena;
+    return arena;
+}
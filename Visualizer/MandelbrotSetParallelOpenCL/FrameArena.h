@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#define CACHE_LINE_SIZE 64
+
+// Scratch memory of one render. Buffers are carved out of large blocks that stay allocated, and already
+// touched, across renders; reset() hands the whole arena out again for the next frame.
+class FrameArena {
+public:
+    ~FrameArena();
+    // Cache-line aligned, uninitialised memory for count values, valid until the next reset
+    template<typename T>
+    T* allocate(size_t count) {
+        return static_cast<T*>(allocateBytes(sizeof(T) * count));
+    }
+    // Blocks added while the last frame grew the arena are merged into one, so steady renders reuse a single block
+    void reset();
+    // Time spent obtaining new blocks and first touching their pages since the last reset
+    double getAllocationMs() const;
+    size_t getCapacity() const;
+    // Back new blocks with huge pages where the system grants them, normal pages otherwise
+    void setHugePages(bool enabled);
+private:
+    struct Block {
+        char* data;
+        size_t size;
+        size_t used;
+        size_t touched;     // pages below this offset have been faulted in
+        bool hugePages;
+    };
+    void* allocateBytes(size_t bytes);
+    Block allocateBlock(size_t bytes);
+    void freeBlock(const Block& block);
+    std::vector<Block> blocks;
+    size_t current = 0;
+    double allocationMs = 0;
+    bool hugePages = false;
+};
+
+// The arena shared by every render of the process
+FrameArena& frameArena();
+#endif
@@ -0,0 +1,252 @@
+#include <ImageWriter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <omp.h>
+#include <vector>
+#include <zlib.h>
+
+// Rows per independently compressed strip, large enough to keep the compression ratio close to a single stream
+const int STRIP_ROWS = 64;
+
+string lowerExtension(const string& fileName) {
+    size_t dot = fileName.find_last_of('.');
+    string extension = dot == string::npos ? "" : fileName.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+void putBigEndian(vector<unsigned char>& out, unsigned int value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((unsigned char)(value >> shift));
+    }
+}
+
+void putLittleEndian(vector<unsigned char>& out, unsigned int value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((unsigned char)(value >> (8 * i)));
+    }
+}
+
+bool writeBytes(const string& fileName, const vector<unsigned char>& header, const vector<unsigned char>& data) {
+    ofstream out(fileName, ios::binary);
+    out.write((const char*)header.data(), header.size());
+    out.write((const char*)data.data(), data.size());
+    return (bool)out;
+}
+
+// Copies a row from BGR to RGB
+void copyRowRgb(const cv::Mat& image, int y, unsigned char* out) {
+    const unsigned char* row = image.data + y * image.step;
+    for (int x = 0; x < image.cols; x++) {
+        out[3 * x] = row[3 * x + 2];
+        out[3 * x + 1] = row[3 * x + 1];
+        out[3 * x + 2] = row[3 * x];
+    }
+}
+
+bool writePpm(const cv::Mat& image, const string& fileName) {
+    size_t rowSize = (size_t)image.cols * 3;
+    vector<unsigned char> data(rowSize * image.rows);
+    #pragma omp parallel for
+    for (int y = 0; y < image.rows; y++) {
+        copyRowRgb(image, y, &data[y * rowSize]);
+    }
+    string header = "P6\n" + to_string(image.cols) + " " + to_string(image.rows) + "\n255\n";
+    return writeBytes(fileName, vector<unsigned char>(header.begin(), header.end()), data);
+}
+
+// 24 bit BMP keeps BGR order, rows are stored bottom-up and padded to 4 bytes
+bool writeBmp(const cv::Mat& image, const string& fileName) {
+    size_t rowSize = ((size_t)image.cols * 3 + 3) / 4 * 4;
+    vector<unsigned char> data(rowSize * image.rows, 0);
+    #pragma omp parallel for
+    for (int y = 0; y < image.rows; y++) {
+        memcpy(&data[(image.rows - 1 - y) * rowSize], image.data + y * image.step, (size_t)image.cols * 3);
+    }
+    vector<unsigned char> header;
+    header.push_back('B');
+    header.push_back('M');
+    putLittleEndian(header, (unsigned int)(54 + data.size()), 4);
+    putLittleEndian(header, 0, 4);
+    putLittleEndian(header, 54, 4);
+    putLittleEndian(header, 40, 4);
+    putLittleEndian(header, image.cols, 4);
+    putLittleEndian(header, image.rows, 4);
+    putLittleEndian(header, 1, 2);
+    putLittleEndian(header, 24, 2);
+    putLittleEndian(header, 0, 4);
+    putLittleEndian(header, (unsigned int)data.size(), 4);
+    putLittleEndian(header, 2835, 4);
+    putLittleEndian(header, 2835, 4);
+    putLittleEndian(header, 0, 4);
+    putLittleEndian(header, 0, 4);
+    return writeBytes(fileName, header, data);
+}
+
+// Raw deflate of one strip. Strips that are not last end with a sync flush, which leaves the stream
+// byte aligned and unfinished, so the strips concatenate into a single valid deflate stream.
+vector<unsigned char> deflateStrip(const vector<unsigned char>& raw, int level, bool last) {
+    z_stream stream = {};
+    deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    vector<unsigned char> out(deflateBound(&stream, raw.size()) + 16);
+    stream.next_in = const_cast<Bytef*>(raw.data());
+    stream.avail_in = (uInt)raw.size();
+    stream.next_out = out.data();
+    stream.avail_out = (uInt)out.size();
+    deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+void appendPngChunk(vector<unsigned char>& out, const char* type, const vector<unsigned char>& data) {
+    putBigEndian(out, (unsigned int)data.size());
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, (unsigned int)crc32(0, &out[typeStart], (uInt)(out.size() - typeStart)));
+}
+
+// Strips are filtered and compressed in parallel and joined into one zlib stream, the checksum
+// is combined from the per-strip Adler-32 values
+bool writePng(const cv::Mat& image, const string& fileName, int level) {
+    size_t rowSize = (size_t)image.cols * 3;
+    int stripCount = (image.rows + STRIP_ROWS - 1) / STRIP_ROWS;
+    vector<vector<unsigned char>> compressed(stripCount);
+    vector<uLong> checksums(stripCount);
+    vector<size_t> rawSizes(stripCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int strip = 0; strip < stripCount; strip++) {
+        int firstRow = strip * STRIP_ROWS;
+        int lastRow = min(firstRow + STRIP_ROWS, image.rows);
+        vector<unsigned char> raw((rowSize + 1) * (lastRow - firstRow));
+        vector<unsigned char> rgb(rowSize);
+        for (int y = firstRow; y < lastRow; y++) {
+            unsigned char* filtered = &raw[(y - firstRow) * (rowSize + 1)];
+            copyRowRgb(image, y, rgb.data());
+            // Sub filter, smooth colour bands compress much better as differences
+            filtered[0] = level > 0 ? 1 : 0;
+            for (size_t i = 0; i < rowSize; i++) {
+                filtered[i + 1] = level > 0 && i >= 3 ? (unsigned char)(rgb[i] - rgb[i - 3]) : rgb[i];
+            }
+        }
+        compressed[strip] = deflateStrip(raw, level, strip == stripCount - 1);
+        checksums[strip] = adler32(1, raw.data(), (uInt)raw.size());
+        rawSizes[strip] = raw.size();
+    }
+
+    vector<unsigned char> idat = { 0x78, (unsigned char)(level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA) };
+    uLong checksum = 1;
+    for (int strip = 0; strip < stripCount; strip++) {
+        idat.insert(idat.end(), compressed[strip].begin(), compressed[strip].end());
+        checksum = adler32_combine(checksum, checksums[strip], (z_off_t)rawSizes[strip]);
+    }
+    putBigEndian(idat, (unsigned int)checksum);
+
+    vector<unsigned char> ihdr;
+    putBigEndian(ihdr, image.cols);
+    putBigEndian(ihdr, image.rows);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 }); // 8 bit RGB, deflate, adaptive filtering, no interlace
+
+    vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendPngChunk(png, "IHDR", ihdr);
+    appendPngChunk(png, "IDAT", idat);
+    appendPngChunk(png, "IEND", {});
+    return writeBytes(fileName, png, {});
+}
+
+void putTiffEntry(vector<unsigned char>& out, unsigned short tag, unsigned short type, unsigned int count, unsigned int value) {
+    putLittleEndian(out, tag, 2);
+    putLittleEndian(out, type, 2);
+    putLittleEndian(out, count, 4);
+    putLittleEndian(out, value, 4);
+}
+
+// Baseline RGB TIFF with one zlib stream per strip (compression 8), so strips compress independently in parallel
+bool writeTiff(const cv::Mat& image, const string& fileName, int level) {
+    size_t rowSize = (size_t)image.cols * 3;
+    int stripCount = (image.rows + STRIP_ROWS - 1) / STRIP_ROWS;
+    vector<vector<unsigned char>> strips(stripCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int strip = 0; strip < stripCount; strip++) {
+        int firstRow = strip * STRIP_ROWS;
+        int lastRow = min(firstRow + STRIP_ROWS, image.rows);
+        vector<unsigned char> raw(rowSize * (lastRow - firstRow));
+        for (int y = firstRow; y < lastRow; y++) {
+            copyRowRgb(image, y, &raw[(y - firstRow) * rowSize]);
+        }
+        if (level == 0) {
+            strips[strip] = move(raw);
+            continue;
+        }
+        uLongf size = compressBound(raw.size());
+        strips[strip].resize(size);
+        compress2(strips[strip].data(), &size, raw.data(), raw.size(), level);
+        strips[strip].resize(size);
+    }
+
+    // Header, strip data, then the arrays referenced by the directory and the directory itself
+    vector<unsigned char> tiff = { 'I', 'I', 42, 0, 0, 0, 0, 0 };
+    vector<unsigned int> offsets;
+    for (const vector<unsigned char>& strip : strips) {
+        offsets.push_back((unsigned int)tiff.size());
+        tiff.insert(tiff.end(), strip.begin(), strip.end());
+        if (tiff.size() % 2 != 0) {
+            tiff.push_back(0);
+        }
+    }
+    unsigned int bitsOffset = (unsigned int)tiff.size();
+    putLittleEndian(tiff, 8, 2);
+    putLittleEndian(tiff, 8, 2);
+    putLittleEndian(tiff, 8, 2);
+    unsigned int offsetsOffset = (unsigned int)tiff.size();
+    for (unsigned int offset : offsets) {
+        putLittleEndian(tiff, offset, 4);
+    }
+    unsigned int countsOffset = (unsigned int)tiff.size();
+    for (const vector<unsigned char>& strip : strips) {
+        putLittleEndian(tiff, (unsigned int)strip.size(), 4);
+    }
+
+    unsigned int directoryOffset = (unsigned int)tiff.size();
+    for (int i = 0; i < 4; i++) {
+        tiff[4 + i] = (unsigned char)(directoryOffset >> (8 * i));
+    }
+    const unsigned short SHORT = 3;
+    const unsigned short LONG = 4;
+    // A single strip stores its offset and byte count directly in the entry
+    bool single = stripCount == 1;
+    putLittleEndian(tiff, 10, 2);
+    putTiffEntry(tiff, 256, LONG, 1, image.cols);
+    putTiffEntry(tiff, 257, LONG, 1, image.rows);
+    putTiffEntry(tiff, 258, SHORT, 3, bitsOffset);
+    putTiffEntry(tiff, 259, SHORT, 1, level == 0 ? 1 : 8);
+    putTiffEntry(tiff, 262, SHORT, 1, 2);
+    putTiffEntry(tiff, 273, LONG, stripCount, single ? offsets[0] : offsetsOffset);
+    putTiffEntry(tiff, 277, SHORT, 1, 3);
+    putTiffEntry(tiff, 278, LONG, 1, STRIP_ROWS);
+    putTiffEntry(tiff, 279, LONG, stripCount, single ? (unsigned int)strips[0].size() : countsOffset);
+    putTiffEntry(tiff, 284, SHORT, 1, 1);
+    putLittleEndian(tiff, 0, 4);
+    return writeBytes(fileName, tiff, {});
+}
+
+bool writeImage(const cv::Mat& image, const string& fileName, int compressionLevel) {
+    string extension = lowerExtension(fileName);
+    int level = min(max(compressionLevel, 0), 9);
+    if (extension == "ppm") {
+        return writePpm(image, fileName);
+    }
+    if (extension == "bmp") {
+        return writeBmp(image, fileName);
+    }
+    if (extension == "png") {
+        return writePng(image, fileName, level);
+    }
+    if (extension == "tif" || extension == "tiff") {
+        return writeTiff(image, fileName, level);
+    }
+    return cv::imwrite(fileName, image);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+using namespace std;
+
+// Compression level used when none is given, same as zlib's default
+const int DEFAULT_COMPRESSION_LEVEL = 6;
+
+// Writes a BGR image in the format given by the file extension:
+// .ppm, .bmp      uncompressed, for the interactive hot path
+// .png, .tif      deflate compressed in horizontal strips on all cores, compressionLevel 0 - 9
+// anything else   cv::imwrite with its default settings
+bool writeImage(const cv::Mat& image, const string& fileName, int compressionLevel = DEFAULT_COMPRESSION_LEVEL);
+#endif
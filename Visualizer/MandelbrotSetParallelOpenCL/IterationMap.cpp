@@ -0,0 +1,154 @@
+#include <IterationMap.h>
+
+#include <algorithm>
+#include <fstream>
+#include <omp.h>
+#include <zlib.h>
+
+const char ITERATION_MAP_MAGIC[4] = { 'M', 'B', 'I', 'M' };
+const unsigned int ITERATION_MAP_VERSION = 1;
+// Longest varint of a 32-bit value
+const int MAX_VARINT_BYTES = 5;
+
+void putUint32(ofstream& out, unsigned int value) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    out.write((const char*)bytes, 4);
+}
+
+bool getUint32(ifstream& in, unsigned int& value) {
+    unsigned char bytes[4];
+    if (!in.read((char*)bytes, 4)) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (unsigned int)bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+void putString(ofstream& out, const string& text) {
+    putUint32(out, (unsigned int)text.size());
+    out.write(text.data(), text.size());
+}
+
+bool getString(ifstream& in, string& text) {
+    unsigned int length;
+    // Viewport coordinates, anything longer is a damaged file
+    if (!getUint32(in, length) || length > 1 << 16) {
+        return false;
+    }
+    text.resize(length);
+    return length == 0 || (bool)in.read(&text[0], length);
+}
+
+// Iterations are stored plus one, so points that did not escape become 0 and every value is non-negative
+void encodeRow(const int* iters, int width, vector<unsigned char>& out) {
+    int previous = 0;
+    for (int x = 0; x < width; x++) {
+        int value = iters[x] + 1;
+        int delta = value - previous;
+        unsigned int zigzag = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+        while (zigzag >= 0x80) {
+            out.push_back((unsigned char)(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        out.push_back((unsigned char)zigzag);
+        previous = value;
+    }
+}
+
+bool decodeRow(const unsigned char* data, size_t size, int width, int* iters) {
+    size_t position = 0;
+    int previous = 0;
+    for (int x = 0; x < width; x++) {
+        unsigned int zigzag = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (position >= size || shift >= 7 * MAX_VARINT_BYTES) {
+                return false;
+            }
+            unsigned char byte = data[position++];
+            zigzag |= (unsigned int)(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                break;
+            }
+        }
+        int delta = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+        previous += delta;
+        iters[x] = previous - 1;
+    }
+    return position == size;
+}
+
+bool writeIterationMap(const string& fileName, const IterationMapHeader& header, const int* iters, int level) {
+    vector<vector<unsigned char>> rows(header.height);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int y = 0; y < header.height; y++) {
+        vector<unsigned char> raw;
+        raw.reserve((size_t)header.width * 2);
+        encodeRow(iters + (size_t)y * header.width, header.width, raw);
+        uLongf size = compressBound(raw.size());
+        rows[y].resize(size);
+        compress2(rows[y].data(), &size, raw.data(), raw.size(), level);
+        rows[y].resize(size);
+    }
+
+    ofstream out(fileName, ios::binary);
+    out.write(ITERATION_MAP_MAGIC, 4);
+    putUint32(out, ITERATION_MAP_VERSION);
+    putUint32(out, header.width);
+    putUint32(out, header.height);
+    putUint32(out, header.maxIter);
+    putUint32(out, header.precision);
+    putString(out, header.reStart);
+    putString(out, header.reEnd);
+    putString(out, header.imStart);
+    putString(out, header.imEnd);
+    for (const vector<unsigned char>& row : rows) {
+        putUint32(out, (unsigned int)row.size());
+        out.write((const char*)row.data(), row.size());
+    }
+    return (bool)out;
+}
+
+bool readIterationMap(const string& fileName, IterationMapHeader& header, vector<int>& iters) {
+    ifstream in(fileName, ios::binary);
+    char magic[4];
+    unsigned int version, width, height, maxIter, precision;
+    if (!in.read(magic, 4) || !equal(magic, magic + 4, ITERATION_MAP_MAGIC) || !getUint32(in, version) || version != ITERATION_MAP_VERSION
+        || !getUint32(in, width) || !getUint32(in, height) || !getUint32(in, maxIter) || !getUint32(in, precision)
+        || !getString(in, header.reStart) || !getString(in, header.reEnd) || !getString(in, header.imStart) || !getString(in, header.imEnd)
+        || width == 0 || height == 0 || (unsigned long long)width * height > 1u << 31) {
+        return false;
+    }
+    header.width = width;
+    header.height = height;
+    header.maxIter = maxIter;
+    header.precision = precision;
+
+    vector<vector<unsigned char>> rows(height);
+    for (vector<unsigned char>& row : rows) {
+        unsigned int size;
+        if (!getUint32(in, size) || size > compressBound((uLong)width * MAX_VARINT_BYTES)) {
+            return false;
+        }
+        row.resize(size);
+        if (!in.read((char*)row.data(), size)) {
+            return false;
+        }
+    }
+
+    iters.resize((size_t)width * height);
+    bool valid = true;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(&&:valid)
+    for (int y = 0; y < (int)height; y++) {
+        vector<unsigned char> raw((size_t)width * MAX_VARINT_BYTES);
+        uLongf size = raw.size();
+        valid = uncompress(raw.data(), &size, rows[y].data(), rows[y].size()) == Z_OK
+            && decodeRow(raw.data(), size, width, &iters[(size_t)y * width]) && valid;
+    }
+    return valid;
+}
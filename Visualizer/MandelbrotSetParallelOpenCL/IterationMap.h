@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef ITERATION_MAP_H
+#define ITERATION_MAP_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Viewport and precision of a saved render. The viewport is kept as text so deep zooms keep every digit.
+struct IterationMapHeader {
+    int width;
+    int height;
+    int maxIter;
+    int precision;  // PrecisionMode the iterations were computed with
+    string reStart;
+    string reEnd;
+    string imStart;
+    string imEnd;
+};
+
+// .mbi files hold the header followed by the escape iterations row by row. Each row is delta coded
+// against its left neighbour as zigzag varints and deflated on its own, so rows are packed in parallel.
+bool writeIterationMap(const string& fileName, const IterationMapHeader& header, const int* iters, int level);
+// Returns false when the file is missing, damaged or not an iteration map, iters receives width * height values
+bool readIterationMap(const string& fileName, IterationMapHeader& header, vector<int>& iters);
+#endif
@@ -7,14 +7,35 @@
 #include <boost/multiprecision/cpp_int.hpp>
 #include <iomanip>
 #include <omp.h>
+#include <sstream>
+#include <random>
+#include <fstream>
+#include <deque>
+#include <future>
 
 #include "OpenCLWrapper.h"
 #include "FixedPointArithmetics.h"
+#include "DoubleDoubleArithmetics.h"
 #include "ColorManager.h"
+#include "RenderStats.h"
+#include "Benchmark.h"
+#include "WorkloadStats.h"
+#include "VideoEncoder.h"
+#include "ImageWriter.h"
+#include "SharedFrameBuffer.h"
+#include "BatchJobs.h"
+#include "FrameArena.h"
+#include "ThreadPlacement.h"
+#include "IterationMap.h"
+#include "Formula.h"
+#include "Comparison.h"
 
 using namespace std;
 using namespace boost::multiprecision;
 
+// Enough digits to place the reference orbit at zoom depths around 1e-1000
+typedef number<cpp_dec_float<1100>> cpp_dec_float_deep;
+
 //double RE_START = -2.0;
 //double RE_END = 1.0;
 //double IM_START = -1;
@@ -23,13 +44,37 @@ double RE_START = -0.153004885037500013708;
 double RE_END = -0.152809695287500013708;
 double IM_START = 1.039611370300000000002;
 double IM_END = 1.039757762612500000002;
-cpp_dec_float_50 RE_START_HP = RE_START;
-cpp_dec_float_50 RE_END_HP = RE_END;
-cpp_dec_float_50 IM_START_HP = IM_START;
-cpp_dec_float_50 IM_END_HP = IM_END;
+cpp_dec_float_deep RE_START_HP = RE_START;
+cpp_dec_float_deep RE_END_HP = RE_END;
+cpp_dec_float_deep IM_START_HP = IM_START;
+cpp_dec_float_deep IM_END_HP = IM_END;
 bool USE_HIGH_PRECISSION = false;
 
+enum PrecisionMode {
+    PRECISION_DOUBLE = 0,
+    PRECISION_AUTO = 1,         // pick float, double, double-double or perturbation from the pixel spacing
+    PRECISION_DOUBLE_DOUBLE = 2,
+    PRECISION_FIXED_POINT = 3,
+    PRECISION_PERTURBATION = 4,
+    PRECISION_FLOAT = 5
+};
+int PRECISION_MODE = PRECISION_DOUBLE;
+// Precision the last render was computed with, PRECISION_MODE may be automatic
+int RENDERED_PRECISION = PRECISION_DOUBLE;
+
+// Mantissa bits of each tier, minus guard bits lost to rounding while iterating
+const int FLOAT_PRECISION_BITS = 24 - 8;
+// Previews accept rounding errors of a few pixels and use float without guard bits
+const int FLOAT_PREVIEW_PRECISION_BITS = 24;
+bool PREVIEW = false;
+const int DOUBLE_PRECISION_BITS = 53 - 8;
+const int DOUBLE_DOUBLE_PRECISION_BITS = 106 - 8;
+// Fixed point has an absolute resolution, its fraction bits bound the pixel spacing itself
+const int FIXED_POINT_FRACTION_BITS = 96 - 8;
+
 int MAX_ITER = 400;
+// Escape-time formula, anything but the Mandelbrot set is rendered by the specialized double precision kernel
+Formula FORMULA;
 
 //int IMAGE_WIDTH = 6144;
 //int IMAGE_HEIGHT = 4096;
@@ -38,8 +83,39 @@ int IMAGE_HEIGHT = 600;
 int IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
 
 int PALETTE_LENGTH = 256;
+int PALETTE_ID = 0;
 
 string OUTPUT_FILENAME = "./mandelbrot_set.png";
+// When set, frames are published to this memory-mapped ring buffer for the GUI instead of an image file
+string SHARED_FRAME_FILENAME;
+// Deflate level of .png and .tif output, 0 stores the image uncompressed
+int COMPRESSION_LEVEL = DEFAULT_COMPRESSION_LEVEL;
+bool WORKLOAD_STATS = false;
+// Print mapping and coloring throughput per NUMA node after every render
+bool NODE_THROUGHPUT = false;
+// Samples per edge pixel, a square number, 1 disables anti-aliasing
+int AA_SAMPLES = 1;
+// Pixels are supersampled when a neighbour's escape iteration differs by more than this
+int AA_THRESHOLD = 2;
+// Iterations per launch of the double kernel, 0 runs every pixel to completion in one launch
+int CHUNK_ITERATIONS = 0;
+string HEATMAP_FILENAME;
+// Every render also saves its escape iterations here, to be recoloured later without recomputing
+string SAVE_ITERATIONS_FILENAME;
+// When set, the escape iterations of the last render are kept in LAST_ITERATIONS for recolouring
+bool KEEP_ITERATIONS = false;
+vector<int> LAST_ITERATIONS;
+// Colour by the exterior distance estimate instead of the escape iteration, double and fixed point only
+bool DISTANCE_ESTIMATION = false;
+// Pixels from the boundary the distance palette runs over, farther pixels take its last colour
+float DE_BOUNDARY_WIDTH = 8;
+// Edge of the blocks probed by the coarse distance pass
+const int DE_BLOCK_SIZE = 4;
+// The render is abandoned as soon as this file exists, the GUI creates it when a newer request supersedes this one
+string CANCEL_FILENAME;
+const int EXIT_CANCELLED = 2;
+// Returned by --compare when a backend differs from its reference beyond the allowed fraction of pixels
+const int EXIT_COMPARISON_FAILED = 3;
 vector<vector<Color>> palettes = {
     {   // Navy
         {10, 11, 48},
@@ -125,6 +201,9 @@ ColorManager* colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[0], PAL
 //HistogramColorPalette colorManager(IMAGE_SIZE, MAX_ITER, colors2);
 //ExponentialColorPalette colorManager(IMAGE_SIZE, MAX_ITER, colors2, PALETTE_LENGTH);
 
+// When set, renders hand their image over instead of writing OUTPUT_FILENAME (animation keyframes)
+cv::Mat* CAPTURED_IMAGE = nullptr;
+
 void createColorImage(Color* pixels) {
     cv::Mat image(IMAGE_HEIGHT, IMAGE_WIDTH, CV_8UC3);
     uchar* imageData = image.data;
@@ -144,7 +223,22 @@ void createColorImage(Color* pixels) {
         }
     }
 
-    cv::imwrite(OUTPUT_FILENAME, image);
+    if (CAPTURED_IMAGE != nullptr) {
+        *CAPTURED_IMAGE = image;
+        return;
+    }
+    if (!SHARED_FRAME_FILENAME.empty()) {
+        double viewport[4] = { RE_START, RE_END, IM_START, IM_END };
+        if (USE_HIGH_PRECISSION) {
+            viewport[0] = RE_START_HP.convert_to<double>();
+            viewport[1] = RE_END_HP.convert_to<double>();
+            viewport[2] = IM_START_HP.convert_to<double>();
+            viewport[3] = IM_END_HP.convert_to<double>();
+        }
+        publishSharedFrame(SHARED_FRAME_FILENAME, image, viewport);
+        return;
+    }
+    writeImage(image, OUTPUT_FILENAME, COMPRESSION_LEVEL);
 }
 
 double mapVal(double value, double inMin, double inMax, double outMin, double outMax) {
@@ -152,55 +246,374 @@ double mapVal(double value, double inMin, double inMax, double outMin, double ou
 }
 
 
-void createMandelbrotSet() {
-    auto* points = new Complex[IMAGE_HEIGHT * IMAGE_WIDTH];
-    auto* iters = new int[IMAGE_HEIGHT * IMAGE_WIDTH];
+double elapsedMs(chrono::high_resolution_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+// Interior points ran for the whole MAX_ITER, escaped ones for their escape iteration + 1
+unsigned long long countIterations(const int* iters) {
+    unsigned long long total = 0;
+    #pragma omp parallel for reduction(+:total)
+    for (int i = 0; i < IMAGE_SIZE; i++) {
+        total += iters[i] == -1 ? MAX_ITER : iters[i] + 1;
+    }
+    return total;
+}
+
+// Splits the device time of the records added since firstRecord into setup, build, transfer and kernel
+void addDeviceProfile(RenderStats& stats, size_t firstRecord) {
+    double RenderStats::* phases[] = { &RenderStats::setupMs, &RenderStats::buildMs, &RenderStats::transferMs, &RenderStats::kernelMs };
+    for (size_t i = firstRecord; i < getProfilingRecordCount(); i++) {
+        const ProfilingRecord& record = getProfilingRecord(i);
+        stats.*phases[record.category] += (record.endNs - record.startNs) / 1e6;
+    }
+    printProfilingRecords(firstRecord);
+    cout << "Setup: " << stats.setupMs << " ms, build: " << stats.buildMs << " ms, transfer: " << stats.transferMs
+        << " ms, kernel: " << stats.kernelMs << " ms" << endl;
+}
+
+// Shows the tiles finished so far while the render continues, pixels not computed yet are painted like the set
+void publishPartialFrame(const int* iters, unsigned int width, unsigned int height) {
+    if (CAPTURED_IMAGE != nullptr || width != IMAGE_WIDTH || height != IMAGE_HEIGHT) {
+        return;
+    }
+    vector<int> partial(iters, iters + IMAGE_SIZE);
+    replace(partial.begin(), partial.end(), ITERS_NOT_COMPUTED, -1);
+    vector<Color> pixels(IMAGE_SIZE);
+    colorManager->paint(partial.data(), pixels.data(), IMAGE_SIZE);
+    createColorImage(pixels.data());
+}
+
+bool cancelFileExists() {
+    return ifstream(CANCEL_FILENAME).good();
+}
+
+// Stops without writing an image when the render was cancelled
+void exitIfCancelled(int status) {
+    if (status == CALCULATE_ITERS_CANCELLED) {
+        cout << "\nRender cancelled" << endl;
+        exit(EXIT_CANCELLED);
+    }
+}
+
+// Extra samples of the pixels on high-contrast edges, samplesPerPixel per pixel
+struct SuperSamples {
+    vector<int> pixels;
+    vector<int> iters;
+    int samplesPerPixel = 0;
+};
+
+// A pixel is an edge when one of its 4 neighbours differs in escape iteration or is inside the set while it is not
+bool isEdgePixel(const int* iters, int x, int y) {
+    int iter = iters[y * IMAGE_WIDTH + x];
+    const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (const auto& offset : offsets) {
+        int nx = x + offset[0];
+        int ny = y + offset[1];
+        if (nx < 0 || ny < 0 || nx >= IMAGE_WIDTH || ny >= IMAGE_HEIGHT) {
+            continue;
+        }
+        int neighbour = iters[ny * IMAGE_WIDTH + nx];
+        if ((neighbour == -1) != (iter == -1) || abs(neighbour - iter) > AA_THRESHOLD) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Jittered samples on a stratified grid around the pixel. On odd grids the centre cell holds the original
+// sample and is skipped, on even grids the original sits on a corner shared by four cells, so every cell is
+// sampled and the pixel averages AA_SAMPLES + 1 samples.
+SuperSamples superSample(const int* iters) {
+    SuperSamples samples;
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            if (isEdgePixel(iters, x, y)) {
+                samples.pixels.push_back(y * IMAGE_WIDTH + x);
+            }
+        }
+    }
+    if (samples.pixels.empty()) {
+        return samples;
+    }
 
+    int grid = (int)lround(sqrt((double)AA_SAMPLES));
+    int center = grid % 2 == 1 ? grid / 2 * grid + grid / 2 : -1;
+    samples.samplesPerPixel = grid % 2 == 1 ? AA_SAMPLES - 1 : AA_SAMPLES;
+    double pixelWidth = (RE_END - RE_START) / IMAGE_WIDTH;
+    double pixelHeight = (IM_END - IM_START) / IMAGE_HEIGHT;
+    mt19937 random(12345);
+    uniform_real_distribution<double> jitter(0.0, 1.0);
+
+    vector<Complex> points;
+    points.reserve(samples.pixels.size() * samples.samplesPerPixel);
+    for (int pixel : samples.pixels) {
+        double real = mapVal(pixel % IMAGE_WIDTH, 0, IMAGE_WIDTH, RE_START, RE_END);
+        double imag = mapVal(pixel / IMAGE_WIDTH, 0, IMAGE_HEIGHT, IM_START, IM_END);
+        for (int cell = 0; cell < grid * grid; cell++) {
+            if (cell == center) {
+                continue;
+            }
+            double dx = (cell % grid + jitter(random)) / grid - 0.5;
+            double dy = (cell / grid + jitter(random)) / grid - 0.5;
+            points.push_back({ real + dx * pixelWidth, imag + dy * pixelHeight });
+        }
+    }
+    samples.iters.resize(points.size());
+    exitIfCancelled(calculateIters(points.data(), samples.iters.data(), points.size(), 1, MAX_ITER));
+    return samples;
+}
+
+string coordinateText(double value, const cpp_dec_float_deep& valueHP) {
+    if (USE_HIGH_PRECISSION) {
+        return valueHP.str();
+    }
+    stringstream text;
+    text << setprecision(17) << value;
+    return text.str();
+}
+
+void saveIterationMap(const int* iters) {
     auto start = chrono::high_resolution_clock::now();
-    auto startX = chrono::high_resolution_clock::now();
-    for (int i = 0; i < IMAGE_HEIGHT; i++) {
-        double imaginaryPart = mapVal(i, 0, IMAGE_HEIGHT, IM_START, IM_END);
-        for (int j = 0; j < IMAGE_WIDTH; j++) {
-            double realPart = mapVal(j, 0, IMAGE_WIDTH, RE_START, RE_END);
-            int idx = j + (i * IMAGE_WIDTH);
-            points[idx] = { realPart, imaginaryPart };
+    IterationMapHeader header = { IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER, RENDERED_PRECISION,
+        coordinateText(RE_START, RE_START_HP), coordinateText(RE_END, RE_END_HP),
+        coordinateText(IM_START, IM_START_HP), coordinateText(IM_END, IM_END_HP) };
+    if (!writeIterationMap(SAVE_ITERATIONS_FILENAME, header, iters, COMPRESSION_LEVEL)) {
+        cerr << "Could not write " << SAVE_ITERATIONS_FILENAME << endl;
+        return;
+    }
+    cout << "Iteration map: " << elapsedMs(start) << " ms" << endl;
+}
+
+void paintAndSaveImage(int* iters, RenderStats& stats, const SuperSamples* superSamples = nullptr, const float* distances = nullptr) {
+    stats.totalIterations = countIterations(iters);
+    if (superSamples != nullptr) {
+        for (int iter : superSamples->iters) {
+            stats.totalIterations += iter == -1 ? MAX_ITER : iter + 1;
         }
     }
-    auto end = chrono::high_resolution_clock::now();
-    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Pixel mapping: " << duration.count() << " ms\n\n";
-    start = chrono::high_resolution_clock::now();
+    if (WORKLOAD_STATS) {
+        unsigned int workGroupShape[2];
+        getWorkGroupShape(workGroupShape);
+        printWorkloadStats(computeWorkloadStats(iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER, workGroupShape[0], workGroupShape[1]), MAX_ITER);
+    }
+    if (!HEATMAP_FILENAME.empty()) {
+        writeHeatmap(iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER, HEATMAP_FILENAME);
+    }
+    // Distance estimation copies the probe's iterations into the blocks it skips, which makes no iteration map
+    if (!SAVE_ITERATIONS_FILENAME.empty() && distances == nullptr) {
+        saveIterationMap(iters);
+    }
+    if (KEEP_ITERATIONS && iters != LAST_ITERATIONS.data()) {
+        LAST_ITERATIONS.assign(iters, iters + IMAGE_SIZE);
+    }
+    auto start = chrono::high_resolution_clock::now();
+
+    auto* pixels = frameArena().allocate<Color>(IMAGE_SIZE);
 
-    calculateIters(points, iters, IMAGE_SIZE, MAX_ITER);
+    if (superSamples != nullptr && !superSamples->pixels.empty()) {
+        // The samples are painted together with the image, so palettes depending on the whole image see them too
+        int count = IMAGE_SIZE + superSamples->iters.size();
+        auto* allIters = frameArena().allocate<int>(count);
+        auto* allPixels = frameArena().allocate<Color>(count);
+        copy(iters, iters + IMAGE_SIZE, allIters);
+        copy(superSamples->iters.begin(), superSamples->iters.end(), allIters + IMAGE_SIZE);
+        colorManager->paint(allIters, allPixels, count);
+        copy(allPixels, allPixels + IMAGE_SIZE, pixels);
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "\nCalculating escape iteration: " << duration.count() << " ms" << endl;
+        int samplesPerPixel = superSamples->samplesPerPixel;
+        #pragma omp parallel for
+        for (int i = 0; i < (int)superSamples->pixels.size(); i++) {
+            int pixel = superSamples->pixels[i];
+            double sum[3] = { 0, 0, 0 };
+            accumulateLinear(allPixels[pixel], sum);
+            for (int j = 0; j < samplesPerPixel; j++) {
+                accumulateLinear(allPixels[IMAGE_SIZE + i * samplesPerPixel + j], sum);
+            }
+            pixels[pixel] = averageLinear(sum, samplesPerPixel + 1);
+        }
+    }
+    else if (distances != nullptr) {
+        paintDistances(distances, pixels, IMAGE_SIZE, palettes[PALETTE_ID], DE_BOUNDARY_WIDTH);
+    }
+    else {
+        colorManager->paint(iters, pixels, IMAGE_SIZE);
+    }
+
+    stats.coloringMs = elapsedMs(start);
+    cout << "Coloring: " << stats.coloringMs << " ms" << endl;
     start = chrono::high_resolution_clock::now();
 
-    delete[] points;
+    createColorImage(pixels);
+
+    stats.imageMs = elapsedMs(start);
+    cout << "Image building: " << stats.imageMs << " ms" << endl;
+    // Every path allocates its last buffer here, so this covers the whole frame
+    stats.allocationMs = frameArena().getAllocationMs();
+    cout << "Frame arena: " << stats.allocationMs << " ms allocating, " << (frameArena().getCapacity() >> 20) << " MB" << endl;
+    if (NODE_THROUGHPUT) {
+        printNodeThroughput();
+    }
+}
+
+// Renders distance estimates with one probe per DE_BLOCK_SIZE block first. The estimate is at most 4 times the true
+// distance, so a block whose probe is farther than 4 * (block radius + DE_BOUNDARY_WIDTH) holds no pixel within the
+// palette range and takes the probe's result. Only the remaining blocks are rendered per pixel.
+// calculate(pixels, iters, distances, width, height) renders the listed pixel indices laid out as width x height.
+template<typename Calculate>
+void calculateDistancesByBlocks(int* iters, float* distances, Calculate calculate) {
+    int blocksX = (IMAGE_WIDTH + DE_BLOCK_SIZE - 1) / DE_BLOCK_SIZE;
+    int blocksY = (IMAGE_HEIGHT + DE_BLOCK_SIZE - 1) / DE_BLOCK_SIZE;
+    vector<int> probes(blocksX * blocksY);
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            int x = min(bx * DE_BLOCK_SIZE + DE_BLOCK_SIZE / 2, IMAGE_WIDTH - 1);
+            int y = min(by * DE_BLOCK_SIZE + DE_BLOCK_SIZE / 2, IMAGE_HEIGHT - 1);
+            probes[by * blocksX + bx] = y * IMAGE_WIDTH + x;
+        }
+    }
+    vector<int> probeIters(probes.size());
+    vector<float> probeDistances(probes.size());
+    exitIfCancelled(calculate(probes, probeIters.data(), probeDistances.data(), blocksX, blocksY));
+
+    float skipDistance = 4 * (DE_BLOCK_SIZE * 0.7072f + DE_BOUNDARY_WIDTH);
+    vector<int> refined;
+    for (int i = 0; i < IMAGE_SIZE; i++) {
+        int block = (i / IMAGE_WIDTH / DE_BLOCK_SIZE) * blocksX + (i % IMAGE_WIDTH) / DE_BLOCK_SIZE;
+        if (probeDistances[block] > skipDistance) {
+            iters[i] = probeIters[block];
+            distances[i] = probeDistances[block];
+        }
+        else {
+            refined.push_back(i);
+        }
+    }
+    size_t refinedCount = refined.size();
+    cout << "Distance estimation: " << IMAGE_SIZE - refinedCount << " of " << IMAGE_SIZE << " pixels taken from far probes" << endl;
+    if (refined.empty()) {
+        return;
+    }
 
-    auto* pixels = new Color[IMAGE_SIZE];
+    // Laid out in rows of the image width so the launches cover the same tiles as a full image
+    int rows = (refinedCount + IMAGE_WIDTH - 1) / IMAGE_WIDTH;
+    refined.resize(rows * IMAGE_WIDTH, refined.back());
+    vector<int> refinedIters(refined.size());
+    vector<float> refinedDistances(refined.size());
+    exitIfCancelled(calculate(refined, refinedIters.data(), refinedDistances.data(), IMAGE_WIDTH, rows));
+    for (size_t i = 0; i < refinedCount; i++) {
+        iters[refined[i]] = refinedIters[i];
+        distances[refined[i]] = refinedDistances[i];
+    }
+}
 
-    colorManager->paint(iters, pixels);
+RenderStats createMandelbrotSet() {
+    frameArena().reset();
+    auto* points = frameArena().allocate<Complex>(IMAGE_SIZE);
+    auto* iters = frameArena().allocate<int>(IMAGE_SIZE);
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Coloring: " << duration.count() << " ms" << endl;
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    auto start = chrono::high_resolution_clock::now();
+    auto startX = start;
+    parallelStaticTimed("Mapping rows", IMAGE_HEIGHT, [&](long long firstRow, long long endRow) {
+        for (int i = firstRow; i < endRow; i++) {
+            double imaginaryPart = mapVal(i, 0, IMAGE_HEIGHT, IM_START, IM_END);
+            for (int j = 0; j < IMAGE_WIDTH; j++) {
+                double realPart = mapVal(j, 0, IMAGE_WIDTH, RE_START, RE_END);
+                int idx = j + (i * IMAGE_WIDTH);
+                points[idx] = { realPart, imaginaryPart };
+            }
+        }
+    });
+    stats.mappingMs = elapsedMs(start);
+    cout << "Pixel mapping: " << stats.mappingMs << " ms\n\n";
     start = chrono::high_resolution_clock::now();
 
-    delete[] iters;
+    size_t firstRecord = getProfilingRecordCount();
+    vector<float> distances;
+    if (DISTANCE_ESTIMATION) {
+        distances.resize(IMAGE_SIZE);
+        double pixelSize = abs(RE_END - RE_START) / IMAGE_WIDTH;
+        calculateDistancesByBlocks(iters, distances.data(),
+            [&](const vector<int>& pixels, int* pixelIters, float* pixelDistances, unsigned int width, unsigned int height) {
+                vector<Complex> pixelPoints(pixels.size());
+                for (size_t i = 0; i < pixels.size(); i++) {
+                    pixelPoints[i] = points[pixels[i]];
+                }
+                return calculateDistances(pixelPoints.data(), pixelIters, pixelDistances, width, height, MAX_ITER, pixelSize);
+            });
+    }
+    else if (CHUNK_ITERATIONS > 0) {
+        vector<unsigned int> activeCounts;
+        exitIfCancelled(calculateItersChunked(points, iters, IMAGE_SIZE, MAX_ITER, CHUNK_ITERATIONS, activeCounts));
+        cout << "Launches of " << CHUNK_ITERATIONS << " iterations: " << activeCounts.size() << ", active pixels:";
+        for (unsigned int count : activeCounts) {
+            cout << " " << count;
+        }
+        cout << endl;
+    }
+    else {
+        exitIfCancelled(calculateIters(points, iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER));
+    }
 
-    createColorImage(pixels);
+    stats.iterationMs = elapsedMs(start);
+    cout << "\nCalculating escape iteration: " << stats.iterationMs << " ms" << endl;
+    addDeviceProfile(stats, firstRecord);
 
-    delete[] pixels;
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Image building: " << duration.count() << " ms" << endl;
-    auto endX = chrono::high_resolution_clock::now();
-    cout << "Total time: " << chrono::duration_cast<chrono::milliseconds>(endX - startX).count() << " ms" << endl;
+    SuperSamples superSamples;
+    if (AA_SAMPLES > 1 && !DISTANCE_ESTIMATION) {
+        start = chrono::high_resolution_clock::now();
+        superSamples = superSample(iters);
+        double superSamplingMs = elapsedMs(start);
+        stats.iterationMs += superSamplingMs;
+        cout << "Supersampling " << superSamples.pixels.size() << " edge pixels (" << superSamples.iters.size()
+            << " samples): " << superSamplingMs << " ms" << endl;
+    }
+
+    paintAndSaveImage(iters, stats, &superSamples, DISTANCE_ESTIMATION ? distances.data() : nullptr);
 
+    stats.totalMs = elapsedMs(startX);
+    cout << "Total time: " << stats.totalMs << " ms" << endl;
+    return stats;
+}
+
+// Maps in double and rounds each point to float
+RenderStats createMandelbrotSetFloat() {
+    frameArena().reset();
+    auto* points = frameArena().allocate<ComplexFloat>(IMAGE_SIZE);
+    auto* iters = frameArena().allocate<int>(IMAGE_SIZE);
+
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    auto start = chrono::high_resolution_clock::now();
+    auto startX = start;
+    parallelStaticTimed("Mapping rows", IMAGE_HEIGHT, [&](long long firstRow, long long endRow) {
+        for (int i = firstRow; i < endRow; i++) {
+            float imaginaryPart = (float)mapVal(i, 0, IMAGE_HEIGHT, IM_START, IM_END);
+            for (int j = 0; j < IMAGE_WIDTH; j++) {
+                float realPart = (float)mapVal(j, 0, IMAGE_WIDTH, RE_START, RE_END);
+                int idx = j + (i * IMAGE_WIDTH);
+                points[idx] = { realPart, imaginaryPart };
+            }
+        }
+    });
+    stats.mappingMs = elapsedMs(start);
+    cout << "Pixel mapping: " << stats.mappingMs << " ms\n\n";
+    start = chrono::high_resolution_clock::now();
+
+    size_t firstRecord = getProfilingRecordCount();
+    exitIfCancelled(calculateItersFloat(points, iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER));
+
+    stats.iterationMs = elapsedMs(start);
+    cout << "\nCalculating escape iteration: " << stats.iterationMs << " ms" << endl;
+    addDeviceProfile(stats, firstRecord);
+
+    paintAndSaveImage(iters, stats);
+
+    stats.totalMs = elapsedMs(startX);
+    cout << "Total time: " << stats.totalMs << " ms" << endl;
+    return stats;
 }
 
 void convertToFixedPoint(const cpp_dec_float_50& num, unsigned int res[4]) {
@@ -222,84 +635,1222 @@ void convertToFixedPoint(const cpp_dec_float_50& num, unsigned int res[4]) {
     }
 }
 
-void createMandelbrotSetHP() {
-    auto* points = new ComplexHP[IMAGE_HEIGHT * IMAGE_WIDTH];
-    auto* iters = new int[IMAGE_HEIGHT * IMAGE_WIDTH];
+void convertToDoubleDouble(const cpp_dec_float_deep& num, double res[2]) {
+    res[0] = num.convert_to<double>();
+    cpp_dec_float_deep remainder = num - res[0];
+    res[1] = remainder.convert_to<double>();
+}
+
+RenderStats createMandelbrotSetDD() {
+    frameArena().reset();
+    auto* points = frameArena().allocate<ComplexDD>(IMAGE_SIZE);
+    auto* iters = frameArena().allocate<int>(IMAGE_SIZE);
+
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    auto start = chrono::high_resolution_clock::now();
+    auto startX = start;
+    double reStart[2];
+    double imStart[2];
+    double scaleReal[2];
+    double scaleImaginary[2];
+    convertToDoubleDouble(RE_START_HP, reStart);
+    convertToDoubleDouble(IM_START_HP, imStart);
+    convertToDoubleDouble((RE_END_HP - RE_START_HP) / IMAGE_WIDTH, scaleReal);
+    convertToDoubleDouble((IM_END_HP - IM_START_HP) / IMAGE_HEIGHT, scaleImaginary);
+
+    parallelStaticTimed("Mapping rows", IMAGE_HEIGHT, [&](long long firstRow, long long endRow) {
+        for (int i = firstRow; i < endRow; i++) {
+            double imaginaryPart[2];
+            dda::mulDoubleDD(scaleImaginary, i, imaginaryPart);
+            dda::addDD(imStart, imaginaryPart, imaginaryPart);
+            for (int j = 0; j < IMAGE_WIDTH; j++) {
+                double realPart[2];
+                dda::mulDoubleDD(scaleReal, j, realPart);
+                dda::addDD(reStart, realPart, realPart);
+                int idx = j + (i * IMAGE_WIDTH);
+                points[idx] = { { realPart[0], realPart[1] }, { imaginaryPart[0], imaginaryPart[1] } };
+            }
+        }
+    });
+    stats.mappingMs = elapsedMs(start);
+    cout << "Pixel mapping: " << stats.mappingMs << " ms\n\n";
+    start = chrono::high_resolution_clock::now();
+
+    size_t firstRecord = getProfilingRecordCount();
+    exitIfCancelled(calculateItersDoubleDouble(points, iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER));
+
+    stats.iterationMs = elapsedMs(start);
+    cout << "\nCalculating escape iteration: " << stats.iterationMs << " ms" << endl;
+    addDeviceProfile(stats, firstRecord);
+
+
+    paintAndSaveImage(iters, stats);
+
+    stats.totalMs = elapsedMs(startX);
+    cout << "Total time: " << stats.totalMs << " ms" << endl;
+    return stats;
+}
+
+// Fills axis[k] with start + k * step, converting only the start and step to fixed point.
+// Every further coordinate costs one fixed point addition. The step is carried with
+// another 96 fraction bits below the fixed point precision, so truncating it does
+// not add up to a visible drift across the axis.
+FixedPointAxis fixedPointAxis(const cpp_dec_float_50& start, const cpp_dec_float_50& step) {
+    FixedPointAxis axis;
+    convertToFixedPoint(start, axis.start);
+
+    cpp_dec_float_50 stepAbs = abs(step);
+    convertToFixedPoint(stepAbs, axis.step);
+    cpp_dec_float_50 stepScaled = stepAbs * cpp_dec_float_50("79228162514264337593543950336");
+    convertToFixedPoint(stepScaled - floor(stepScaled), axis.stepLow);
+    axis.descending = step < 0;
+    return axis;
+}
+
+// Same coordinates as the fixed point kernel derives from the axis
+void mapAxisFixedPoint(const FixedPointAxis& axis, int count, unsigned int coordinates[][4]) {
+    unsigned int offset[4] = { 0, 0, 0, 0 };
+    unsigned int offsetLow[4] = { 0, 0, 0, 0 };
+    for (int k = 0; k < count; k++) {
+        if (axis.descending) {
+            fpa::subFixed(axis.start, offset, coordinates[k]);
+        }
+        else {
+            fpa::addFixed(axis.start, offset, coordinates[k]);
+        }
+        fpa::addFixed(offsetLow, axis.stepLow, offsetLow);
+        if (offsetLow[0] != 0) {
+            // The low fraction overflowed into a unit of the last fixed point limb
+            offsetLow[0] = 0;
+            fpa::incFixed(offset, offset);
+        }
+        fpa::addFixed(offset, axis.step, offset);
+    }
+}
+
+void viewportFixedPointAxes(FixedPointAxis& realAxis, FixedPointAxis& imagAxis) {
+    // 50 digits are more than the 96 fraction bits of the fixed point format can hold
+    cpp_dec_float_50 reStart = RE_START_HP.convert_to<cpp_dec_float_50>();
+    cpp_dec_float_50 imStart = IM_START_HP.convert_to<cpp_dec_float_50>();
+    cpp_dec_float_50 scaleImaginary = ((IM_END_HP - IM_START_HP) / IMAGE_HEIGHT).convert_to<cpp_dec_float_50>();
+    cpp_dec_float_50 scaleReal = ((RE_END_HP - RE_START_HP) / IMAGE_WIDTH).convert_to<cpp_dec_float_50>();
+
+    realAxis = fixedPointAxis(reStart, scaleReal);
+    imagAxis = fixedPointAxis(imStart, scaleImaginary);
+}
+
+// Only the axes are sent, the kernels derive every pixel from them
+RenderStats createMandelbrotSetFixedPoint() {
+    frameArena().reset();
+    auto* iters = frameArena().allocate<int>(IMAGE_SIZE);
+
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    auto start = chrono::high_resolution_clock::now();
+    auto startX = start;
+    FixedPointAxis realAxis;
+    FixedPointAxis imagAxis;
+    viewportFixedPointAxes(realAxis, imagAxis);
+    stats.mappingMs = elapsedMs(start);
+    cout << "Pixel mapping: " << stats.mappingMs << " ms\n\n";
+    start = chrono::high_resolution_clock::now();
+
+    size_t firstRecord = getProfilingRecordCount();
+    vector<float> distances;
+    if (DISTANCE_ESTIMATION) {
+        distances.resize(IMAGE_SIZE);
+        double pixelSize = abs(((RE_END_HP - RE_START_HP) / IMAGE_WIDTH).convert_to<double>());
+        // The distance pass renders lists of probed and refined pixels, given by their index in the image
+        calculateDistancesByBlocks(iters, distances.data(),
+            [&](const vector<int>& pixels, int* pixelIters, float* pixelDistances, unsigned int width, unsigned int height) {
+                return calculateDistancesHighPrecision(realAxis, imagAxis, pixels.data(), IMAGE_WIDTH, pixelIters, pixelDistances,
+                    width, height, MAX_ITER, pixelSize);
+            });
+    }
+    else {
+        exitIfCancelled(calculateItersHighPrecision(realAxis, imagAxis, iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER));
+    }
+
+    stats.iterationMs = elapsedMs(start);
+    cout << "\nCalculating escape iteration: " << stats.iterationMs << " ms" << endl;
+    addDeviceProfile(stats, firstRecord);
+
+
+    paintAndSaveImage(iters, stats, nullptr, DISTANCE_ESTIMATION ? distances.data() : nullptr);
+
+    stats.totalMs = elapsedMs(startX);
+    cout << "Total time: " << stats.totalMs << " ms" << endl;
+    return stats;
+}
+
+FloatExp convertToFloatExp(const cpp_dec_float_deep& num) {
+    if (num == 0) {
+        return { 0, 0 };
+    }
+    int exponent;
+    cpp_dec_float_deep mantissa = frexp(num, &exponent);
+    return fea::makeFE(mantissa.convert_to<double>(), exponent);
+}
+
+// The last reference orbit is kept, renders whose viewport still contains its point
+// (every frame of a zoom into that point) skip the high precision iteration
+struct ReferenceOrbit {
+    cpp_dec_float_deep real;
+    cpp_dec_float_deep imag;
+    int maxIter = -1;
+    vector<Complex> orbit;
+};
+ReferenceOrbit cachedReferenceOrbit;
+
+bool isInsideViewport(const cpp_dec_float_deep& real, const cpp_dec_float_deep& imag) {
+    return real >= min(RE_START_HP, RE_END_HP) && real <= max(RE_START_HP, RE_END_HP)
+        && imag >= min(IM_START_HP, IM_END_HP) && imag <= max(IM_START_HP, IM_END_HP);
+}
+
+RenderStats createMandelbrotSetPerturbation() {
+    frameArena().reset();
+    auto* iters = frameArena().allocate<int>(IMAGE_SIZE);
+
+    // The reference orbit goes through the center of the viewport, every pixel
+    // is iterated as a small delta from it
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    auto start = chrono::high_resolution_clock::now();
+    auto startX = start;
+    ReferenceOrbit& reference = cachedReferenceOrbit;
+    if (reference.maxIter != MAX_ITER || !isInsideViewport(reference.real, reference.imag)) {
+        reference.real = (RE_START_HP + RE_END_HP) / 2;
+        reference.imag = (IM_START_HP + IM_END_HP) / 2;
+        reference.maxIter = MAX_ITER;
+        reference.orbit.clear();
+        reference.orbit.reserve(MAX_ITER + 1);
+        reference.orbit.push_back({ 0, 0 });
+        cpp_dec_float_deep x = 0;
+        cpp_dec_float_deep y = 0;
+        cpp_dec_float_deep x2 = 0;
+        cpp_dec_float_deep y2 = 0;
+        for (int i = 0; i < MAX_ITER; i++) {
+            y = (x + x) * y + reference.imag;
+            x = x2 - y2 + reference.real;
+            x2 = x * x;
+            y2 = y * y;
+            reference.orbit.push_back({ x.convert_to<double>(), y.convert_to<double>() });
+            if (x2 + y2 > 4) {
+                break;
+            }
+        }
+    }
+    const cpp_dec_float_deep& centerReal = reference.real;
+    const cpp_dec_float_deep& centerImaginary = reference.imag;
+    vector<Complex>& referenceOrbit = reference.orbit;
+
+    FloatExp deltaOrigin[2] = { convertToFloatExp(RE_START_HP - centerReal), convertToFloatExp(IM_START_HP - centerImaginary) };
+    FloatExp deltaStep[2] = { convertToFloatExp((RE_END_HP - RE_START_HP) / IMAGE_WIDTH), convertToFloatExp((IM_END_HP - IM_START_HP) / IMAGE_HEIGHT) };
+
+    stats.mappingMs = elapsedMs(start);
+    cout << "Reference orbit (" << referenceOrbit.size() << " iterations): " << stats.mappingMs << " ms\n\n";
+    start = chrono::high_resolution_clock::now();
+
+    size_t firstRecord = getProfilingRecordCount();
+    exitIfCancelled(calculateItersPerturbation(referenceOrbit.data(), referenceOrbit.size(), deltaOrigin, deltaStep, iters, IMAGE_WIDTH, IMAGE_HEIGHT, MAX_ITER));
+
+    stats.iterationMs = elapsedMs(start);
+    cout << "\nCalculating escape iteration: " << stats.iterationMs << " ms" << endl;
+    addDeviceProfile(stats, firstRecord);
+
+    paintAndSaveImage(iters, stats);
+
+    stats.totalMs = elapsedMs(startX);
+    cout << "Total time: " << stats.totalMs << " ms" << endl;
+    return stats;
+}
+
+// The smaller of the real and imaginary distance between neighbouring pixels
+cpp_dec_float_deep pixelSpacing() {
+    cpp_dec_float_deep scaleImaginary = abs(IM_END_HP - IM_START_HP) / IMAGE_HEIGHT;
+    cpp_dec_float_deep scaleReal = abs(RE_END_HP - RE_START_HP) / IMAGE_WIDTH;
+    return scaleReal < scaleImaginary ? scaleReal : scaleImaginary;
+}
+
+bool fixedPointResolvesPixels() {
+    return log2(pixelSpacing().convert_to<double>()) >= -FIXED_POINT_FRACTION_BITS;
+}
+
+// Picks the cheapest tier that can still tell neighbouring pixels apart
+PrecisionMode selectPrecision() {
+    cpp_dec_float_deep spacing = pixelSpacing();
+
+    cpp_dec_float_deep magnitude = 0;
+    for (const cpp_dec_float_deep* bound : { &RE_START_HP, &RE_END_HP, &IM_START_HP, &IM_END_HP }) {
+        cpp_dec_float_deep boundAbs = abs(*bound);
+        if (boundAbs > magnitude) {
+            magnitude = boundAbs;
+        }
+    }
+
+    // Past the range of a double the tier is decided by the deepest option anyway
+    double requiredBits = log2((magnitude / spacing).convert_to<double>());
+    cout << "Required precision: " << requiredBits << " bits\n";
+    if (requiredBits <= (PREVIEW ? FLOAT_PREVIEW_PRECISION_BITS : FLOAT_PRECISION_BITS)) {
+        return PRECISION_FLOAT;
+    }
+    if (requiredBits <= DOUBLE_PRECISION_BITS) {
+        return PRECISION_DOUBLE;
+    }
+    if (requiredBits <= DOUBLE_DOUBLE_PRECISION_BITS) {
+        return PRECISION_DOUBLE_DOUBLE;
+    }
+    return PRECISION_PERTURBATION;
+}
+
+const char* PRECISION_NAMES[] = { "double", "automatic", "double-double", "fixed point", "perturbation", "float" };
+
+RenderStats createMandelbrotSetHP() {
+    int precision = PRECISION_MODE == PRECISION_AUTO ? selectPrecision() : PRECISION_MODE;
+    // Distance estimation, anti-aliasing and chunked launches run on the double path
+    if (precision == PRECISION_FLOAT && (DISTANCE_ESTIMATION || AA_SAMPLES > 1 || CHUNK_ITERATIONS > 0)) {
+        precision = PRECISION_DOUBLE;
+    }
+    // Only the double and fixed point kernels track the derivative. Fixed point stands in for the deeper tiers
+    // as long as its fraction bits resolve the pixels, past that it would render noise.
+    if (DISTANCE_ESTIMATION && precision != PRECISION_DOUBLE) {
+        if (!fixedPointResolvesPixels()) {
+            cerr << "Distance estimation needs fixed point, which cannot resolve a pixel spacing below 2^-"
+                << FIXED_POINT_FRACTION_BITS << endl;
+            exit(1);
+        }
+        if (precision != PRECISION_FIXED_POINT) {
+            cout << "Distance estimation renders in fixed point instead of " << PRECISION_NAMES[precision] << "\n";
+        }
+        precision = PRECISION_FIXED_POINT;
+    }
+    if (!isMandelbrot(FORMULA) && precision != PRECISION_DOUBLE && precision != PRECISION_FLOAT) {
+        cout << formulaName(FORMULA) << " is only rendered in float or double precision\n";
+        precision = PRECISION_DOUBLE;
+    }
+    cout << "Precision: " << PRECISION_NAMES[precision] << "\n";
+    RENDERED_PRECISION = precision;
+    if (precision == PRECISION_DOUBLE || precision == PRECISION_FLOAT) {
+        RE_START = RE_START_HP.convert_to<double>();
+        RE_END = RE_END_HP.convert_to<double>();
+        IM_START = IM_START_HP.convert_to<double>();
+        IM_END = IM_END_HP.convert_to<double>();
+    }
+    switch (precision) {
+    case PRECISION_FLOAT:
+        return createMandelbrotSetFloat();
+    case PRECISION_DOUBLE:
+        return createMandelbrotSet();
+    case PRECISION_DOUBLE_DOUBLE:
+        return createMandelbrotSetDD();
+    case PRECISION_FIXED_POINT:
+        return createMandelbrotSetFixedPoint();
+    default:
+        return createMandelbrotSetPerturbation();
+    }
+}
+
+// Paints iterations of an earlier render with the current palette, only the coloring and output stages run
+RenderStats recolorIterations(int* iters) {
+    auto start = chrono::high_resolution_clock::now();
+    delete colorManager;
+    colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[PALETTE_ID], PALETTE_LENGTH);
+    frameArena().reset();
+    RenderStats stats;
+    stats.pixels = IMAGE_SIZE;
+    paintAndSaveImage(iters, stats);
+    stats.totalMs = elapsedMs(start);
+    return stats;
+}
 
+// Paints a saved iteration map with the current palette, the image size, viewport and MAX_ITER come from the file
+int recolorIterationMap(const string& fileName) {
     auto start = chrono::high_resolution_clock::now();
-    cpp_dec_float_50 zeroHP = 0;
-    cpp_dec_float_50 scaleImaginary = (IM_END_HP - IM_START_HP) / cpp_dec_float_50(IMAGE_HEIGHT);
-    cpp_dec_float_50 scaleReal = (RE_END_HP - RE_START_HP) / cpp_dec_float_50(IMAGE_WIDTH);
+    IterationMapHeader header;
+    vector<int> iters;
+    if (!readIterationMap(fileName, header, iters) || header.precision < PRECISION_DOUBLE || header.precision > PRECISION_FLOAT) {
+        cerr << "Could not read iteration map " << fileName << endl;
+        return 1;
+    }
+    cout << "Iteration map: " << elapsedMs(start) << " ms loading " << PRECISION_NAMES[header.precision] << " render" << endl;
+    IMAGE_WIDTH = header.width;
+    IMAGE_HEIGHT = header.height;
+    IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
+    MAX_ITER = header.maxIter;
+    RENDERED_PRECISION = header.precision;
+    USE_HIGH_PRECISSION = true;
+    RE_START_HP = cpp_dec_float_deep(header.reStart);
+    RE_END_HP = cpp_dec_float_deep(header.reEnd);
+    IM_START_HP = cpp_dec_float_deep(header.imStart);
+    IM_END_HP = cpp_dec_float_deep(header.imEnd);
+    recolorIterations(iters.data());
+    return 0;
+}
+
+struct BenchmarkViewport {
+    const char* name;
+    const char* reStart;
+    const char* reEnd;
+    const char* imStart;
+    const char* imEnd;
+    int maxIter;
+    vector<int> precisions;
+};
+
+const vector<BenchmarkViewport> BENCHMARK_VIEWPORTS = {
+    { "full-set", "-2.0", "1.0", "-1.0", "1.0", 400,
+        { PRECISION_FLOAT, PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE } },
+    { "seahorse-valley", "-0.7725", "-0.7275", "0.085", "0.115", 1000,
+        { PRECISION_FLOAT, PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT } },
+    { "deep-spot", "-0.153004885037500013708", "-0.152809695287500013708", "1.039611370300000000002", "1.039757762612500000002", 400,
+        { PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT } },
+    { "fixed-point-deep", "-0.743643887037158704758191506114774", "-0.743643887037158704746191506114774",
+        "0.131825904205311970489132056385139", "0.131825904205311970497132056385139", 2000,
+        { PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT, PRECISION_PERTURBATION } },
+    // Pixel spacing around 2^-101, past double-double and fixed point, only perturbation resolves it
+    { "hp-deep-zoom", "-0.743643887037158704752191656114774", "-0.743643887037158704752191356114774",
+        "0.131825904205311970493131956385139", "0.131825904205311970493132156385139", 5000,
+        { PRECISION_PERTURBATION } }
+};
+
+// Renders every benchmark viewport with each of its precisions on each device,
+// runs times per combination, and writes the summary to outputFile
+void runBenchmark(const string& outputFile, int runs, const string& platform, const vector<unsigned int>& deviceTypes) {
+    vector<BenchmarkResult> results;
+    string defaultOutputFile = OUTPUT_FILENAME;
+    OUTPUT_FILENAME = "./benchmark.png";
+    for (unsigned int deviceType : deviceTypes) {
+        setOpenclTarget(platform, deviceType);
+        for (const BenchmarkViewport& viewport : BENCHMARK_VIEWPORTS) {
+            RE_START_HP = cpp_dec_float_deep(viewport.reStart);
+            RE_END_HP = cpp_dec_float_deep(viewport.reEnd);
+            IM_START_HP = cpp_dec_float_deep(viewport.imStart);
+            IM_END_HP = cpp_dec_float_deep(viewport.imEnd);
+            MAX_ITER = viewport.maxIter;
+            for (int precision : viewport.precisions) {
+                PRECISION_MODE = precision;
+                BenchmarkResult result;
+                result.viewport = viewport.name;
+                result.precision = PRECISION_NAMES[precision];
+                result.width = IMAGE_WIDTH;
+                result.height = IMAGE_HEIGHT;
+                result.maxIter = MAX_ITER;
+                // The first render builds the program and tunes the work-group shape, it is left out of the results
+                cout << "\nBenchmark " << viewport.name << " (" << result.precision << "), warm-up\n";
+                createMandelbrotSetHP();
+                for (int run = 0; run < runs; run++) {
+                    cout << "\nBenchmark " << viewport.name << " (" << result.precision << "), run " << run + 1 << "/" << runs << "\n";
+                    result.runs.push_back(createMandelbrotSetHP());
+                }
+                result.device = getOpenclDeviceName();
+                results.push_back(result);
+            }
+        }
+    }
+    OUTPUT_FILENAME = defaultOutputFile;
+    writeBenchmarkResults(results, outputFile);
+    cout << "\nBenchmark results written to " << outputFile << endl;
+}
+
+// Host references for --compare, the OpenCL backends are the PrecisionMode tiers
+const int HOST_SEQUENTIAL = -1;
+const int HOST_FIXED_POINT = -2;
+const int HOST_DOUBLE = -3;
+
+string backendName(int backend) {
+    if (backend == HOST_SEQUENTIAL) {
+        return "sequential";
+    }
+    if (backend == HOST_FIXED_POINT) {
+        return "host-fixed-point";
+    }
+    if (backend == HOST_DOUBLE) {
+        return "host-double";
+    }
+    return PRECISION_NAMES[backend];
+}
+
+struct ComparisonViewport {
+    const char* name;
+    const char* reStart;
+    const char* reEnd;
+    const char* imStart;
+    const char* imEnd;
+    int maxIter;
+    int reference;                  // a host backend
+    vector<int> backends;           // host backends run once, the precisions once per target
+    double maxMismatchFraction;
+};
+
+// Small images keep the host fixed point iteration within seconds
+const int COMPARISON_WIDTH = 240;
+const int COMPARISON_HEIGHT = 160;
 
-    unsigned int realPartFP[4];
-    unsigned int imagPartFP[4];
+const vector<ComparisonViewport> COMPARISON_VIEWPORTS = {
+    { "full-set", "-2.0", "1.0", "-1.0", "1.0", 400, HOST_SEQUENTIAL,
+        { PRECISION_FLOAT, PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT, HOST_DOUBLE, HOST_FIXED_POINT }, 0.01 },
+    { "seahorse-valley", "-0.7725", "-0.7275", "0.085", "0.115", 1000, HOST_SEQUENTIAL,
+        { PRECISION_FLOAT, PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT, PRECISION_PERTURBATION, HOST_DOUBLE,
+            HOST_FIXED_POINT }, 0.01 },
+    { "deep-spot", "-0.153004885037500013708", "-0.152809695287500013708", "1.039611370300000000002", "1.039757762612500000002", 400,
+        HOST_SEQUENTIAL, { PRECISION_DOUBLE, PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT, PRECISION_PERTURBATION, HOST_DOUBLE,
+            HOST_FIXED_POINT }, 0.01 },
+    // Beyond double, only the fixed point format can serve as the reference
+    { "fixed-point-deep", "-0.743643887037158704758191506114774", "-0.743643887037158704746191506114774",
+        "0.131825904205311970489132056385139", "0.131825904205311970497132056385139", 2000, HOST_FIXED_POINT,
+        { PRECISION_DOUBLE_DOUBLE, PRECISION_FIXED_POINT, PRECISION_PERTURBATION }, 0.01 }
+};
+
+// calculateEscapeIterOptimized of SequentialVisualizerEntry.cpp. That program has its own entry point and
+// globals, so its loop is repeated here and has to be kept in step with it.
+int calculateEscapeIterSequential(double x0, double y0, int maxIter) {
+    double x2 = 0;
+    double y2 = 0;
+
+    double x = 0;
+    double y = 0;
+
+    for (int i = 0; i < maxIter; i++) {
+        y = (x + x) * y + y0;
+        x = x2 - y2 + x0;
+        x2 = x * x;
+        y2 = y * y;
+        if (x2 + y2 > 4) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Maps and iterates every pixel on one thread like the sequential visualizer
+void iterateHostSequential(int* iters) {
+    double reStart = RE_START_HP.convert_to<double>();
+    double reEnd = RE_END_HP.convert_to<double>();
+    double imStart = IM_START_HP.convert_to<double>();
+    double imEnd = IM_END_HP.convert_to<double>();
+    for (int i = 0; i < IMAGE_HEIGHT; i++) {
+        for (int j = 0; j < IMAGE_WIDTH; j++) {
+            double realPart = mapVal(j, 0, IMAGE_WIDTH, reStart, reEnd);
+            double imaginaryPart = mapVal(i, 0, IMAGE_HEIGHT, imStart, imEnd);
+            iters[j + i * IMAGE_WIDTH] = calculateEscapeIterSequential(realPart, imaginaryPart, MAX_ITER);
+        }
+    }
+}
+
+// The templated CPU loop of Formula.h, which specialized kernels are checked against
+void iterateHostDouble(int* iters) {
+    double reStart = RE_START_HP.convert_to<double>();
+    double reEnd = RE_END_HP.convert_to<double>();
+    double imStart = IM_START_HP.convert_to<double>();
+    double imEnd = IM_END_HP.convert_to<double>();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < IMAGE_HEIGHT; i++) {
+        double imaginaryPart = mapVal(i, 0, IMAGE_HEIGHT, imStart, imEnd);
+        for (int j = 0; j < IMAGE_WIDTH; j++) {
+            iters[j + i * IMAGE_WIDTH] = iterateFormulaPoint(FORMULA, mapVal(j, 0, IMAGE_WIDTH, reStart, reEnd), imaginaryPart, MAX_ITER);
+        }
+    }
+}
+
+// Host copy of the fixed point kernel loop
+int iterateFixedPoint(const unsigned int x0[4], const unsigned int y0[4], int maxIter) {
+    unsigned int x[4] = { 0, 0, 0, 0 };
+    unsigned int y[4] = { 0, 0, 0, 0 };
+    unsigned int x2[4] = { 0, 0, 0, 0 };
+    unsigned int y2[4] = { 0, 0, 0, 0 };
+    unsigned int temp[4];
+    const unsigned int fourFixed[4] = { 4, 0, 0, 0 };
+    for (int i = 0; i < maxIter; i++) {
+        fpa::addFixed(x, x, temp);
+        fpa::mulCmplFixed(temp, y, temp);
+        fpa::addFixed(temp, y0, y);
+        fpa::subFixed(x2, y2, temp);
+        fpa::addFixed(temp, x0, x);
+        fpa::mulCmplFixed(x, x, x2);
+        fpa::mulCmplFixed(y, y, y2);
+        fpa::addFixed(x2, y2, temp);
+        if (fpa::gtFixed(temp, fourFixed)) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    #pragma omp parallel for private(realPartFP, imagPartFP)
+void iterateHostFixedPoint(int* iters) {
+    FixedPointAxis realAxis;
+    FixedPointAxis imagAxis;
+    viewportFixedPointAxes(realAxis, imagAxis);
+    frameArena().reset();
+    auto* realParts = frameArena().allocate<unsigned int[4]>(IMAGE_WIDTH);
+    auto* imagParts = frameArena().allocate<unsigned int[4]>(IMAGE_HEIGHT);
+    mapAxisFixedPoint(realAxis, IMAGE_WIDTH, realParts);
+    mapAxisFixedPoint(imagAxis, IMAGE_HEIGHT, imagParts);
+    #pragma omp parallel for schedule(dynamic, 1)
     for (int i = 0; i < IMAGE_HEIGHT; i++) {
-        cpp_dec_float_50 imaginaryPart = IM_START_HP + cpp_dec_float_50(i) * scaleImaginary;
         for (int j = 0; j < IMAGE_WIDTH; j++) {
-            cpp_dec_float_50 realPart = RE_START_HP + cpp_dec_float_50(j) * scaleReal;
-            int idx = j + (i * IMAGE_WIDTH);
-            convertToFixedPoint(realPart, realPartFP);
-            convertToFixedPoint(imaginaryPart, imagPartFP);
-            for (int k = 0; k < 4; k++) {
-                points[idx].real[k] = realPartFP[k];
-                points[idx].imag[k] = imagPartFP[k];
+            iters[j + i * IMAGE_WIDTH] = iterateFixedPoint(realParts[j], imagParts[i], MAX_ITER);
+        }
+    }
+}
+
+// Renders every comparison viewport with the host references and with each precision on each
+// target, and diffs the escape iterations pixel for pixel against the viewport's reference.
+// Returns false when any backend fails.
+bool runComparison(const string& outputFile, int tolerance, const vector<pair<string, unsigned int>>& targets) {
+    vector<ComparisonResult> results;
+    int defaultWidth = IMAGE_WIDTH;
+    int defaultHeight = IMAGE_HEIGHT;
+    IMAGE_WIDTH = COMPARISON_WIDTH;
+    IMAGE_HEIGHT = COMPARISON_HEIGHT;
+    IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
+    delete colorManager;
+    colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[PALETTE_ID], PALETTE_LENGTH);
+    // Only the iterations are of interest, the images are dropped
+    cv::Mat image;
+    CAPTURED_IMAGE = &image;
+    KEEP_ITERATIONS = true;
+    for (const ComparisonViewport& viewport : COMPARISON_VIEWPORTS) {
+        RE_START_HP = cpp_dec_float_deep(viewport.reStart);
+        RE_END_HP = cpp_dec_float_deep(viewport.reEnd);
+        IM_START_HP = cpp_dec_float_deep(viewport.imStart);
+        IM_END_HP = cpp_dec_float_deep(viewport.imEnd);
+        MAX_ITER = viewport.maxIter;
+
+        auto addResult = [&](int backend, const string& device, const int* iters, double iterationMs, double totalMs,
+            const vector<int>& reference) {
+            ComparisonResult result;
+            result.viewport = viewport.name;
+            result.backend = backendName(backend);
+            result.reference = backendName(viewport.reference);
+            result.device = device;
+            result.width = IMAGE_WIDTH;
+            result.height = IMAGE_HEIGHT;
+            result.maxIter = MAX_ITER;
+            result.iterationMs = iterationMs;
+            result.totalMs = totalMs;
+            compareIterations(reference.data(), iters, tolerance, viewport.maxMismatchFraction, result);
+            results.push_back(result);
+        };
+        auto runHost = [&](int backend, vector<int>& iters) {
+            cout << "\nComparison " << viewport.name << " (" << backendName(backend) << ")\n";
+            iters.resize(IMAGE_SIZE);
+            auto start = chrono::high_resolution_clock::now();
+            if (backend == HOST_SEQUENTIAL) {
+                iterateHostSequential(iters.data());
+            }
+            else if (backend == HOST_DOUBLE) {
+                iterateHostDouble(iters.data());
+            }
+            else {
+                iterateHostFixedPoint(iters.data());
+            }
+            return elapsedMs(start);
+        };
+
+        vector<int> reference;
+        double referenceMs = runHost(viewport.reference, reference);
+        addResult(viewport.reference, "", reference.data(), referenceMs, referenceMs, reference);
+        for (int backend : viewport.backends) {
+            if (backend >= 0) {
+                continue;
+            }
+            vector<int> iters;
+            double iterationMs = runHost(backend, iters);
+            addResult(backend, "", iters.data(), iterationMs, iterationMs, reference);
+        }
+
+        for (const pair<string, unsigned int>& target : targets) {
+            setOpenclTarget(target.first, target.second);
+            for (int backend : viewport.backends) {
+                if (backend < 0) {
+                    continue;
+                }
+                cout << "\nComparison " << viewport.name << " (" << backendName(backend) << ")\n";
+                PRECISION_MODE = backend;
+                RenderStats stats = createMandelbrotSetHP();
+                // Options like --chunk make some tiers fall back to another one
+                addResult(RENDERED_PRECISION, getOpenclDeviceName(), LAST_ITERATIONS.data(), stats.iterationMs, stats.totalMs, reference);
             }
         }
     }
-    auto end = chrono::high_resolution_clock::now();
-    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Pixel mapping: " << duration.count() << " ms\n\n";
-    start = chrono::high_resolution_clock::now();
+    KEEP_ITERATIONS = false;
+    LAST_ITERATIONS = vector<int>();
+    CAPTURED_IMAGE = nullptr;
+    IMAGE_WIDTH = defaultWidth;
+    IMAGE_HEIGHT = defaultHeight;
+    IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
+    delete colorManager;
+    colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[PALETTE_ID], PALETTE_LENGTH);
 
-    calculateItersHighPrecision(points, iters, IMAGE_SIZE, MAX_ITER);
+    printComparisonResults(results);
+    writeComparisonResults(results, outputFile);
+    cout << "\nComparison results written to " << outputFile << endl;
+    return all_of(results.begin(), results.end(), [](const ComparisonResult& result) { return result.passed; });
+}
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "\nCalculating escape iteration: " << duration.count() << " ms" << endl;
-    start = chrono::high_resolution_clock::now();
+struct ZoomAnimation {
+    cpp_dec_float_deep targetReal;
+    cpp_dec_float_deep targetImag;
+    cpp_dec_float_deep startScale;  // width of the real axis in the first frame
+    cpp_dec_float_deep endScale;
+    int frames = 0;
+    double keyframeScale = 2;       // zoom factor between keyframes, also their size relative to a frame
+    string framePattern = "./frame_%05d.png";
+    string videoTarget;             // when set, frames go to a video file or encoder command instead
+    double videoFps = 30;
+    int videoQueue = 8;
+};
 
-    delete[] points;
+// Zooms from startScale to endScale into the target at a constant rate. Only keyframes are
+// rendered, every keyframeScale-times zoom, at keyframeScale-times the frame size; the frames in
+// between are centred crops of the last keyframe scaled down to the frame size. All keyframes
+// share the warm OpenCL engine and, in perturbation, the reference orbit through the target.
+void runZoomAnimation(const ZoomAnimation& animation) {
+    int frameWidth = IMAGE_WIDTH;
+    int frameHeight = IMAGE_HEIGHT;
+    // Shallow keyframes are cheaper in double, deep ones need one of the extended tiers
+    if (PRECISION_MODE == PRECISION_DOUBLE) {
+        PRECISION_MODE = PRECISION_AUTO;
+    }
 
-    auto* pixels = new Color[IMAGE_SIZE];
+    double logZoom = log(animation.startScale / animation.endScale).convert_to<double>();
+    double logKeyframeZoom = log(animation.keyframeScale);
+    VideoEncoder* encoder = nullptr;
+    if (!animation.videoTarget.empty()) {
+        encoder = new VideoEncoder(animation.videoTarget, frameWidth, frameHeight, animation.videoFps, animation.videoQueue);
+        if (!encoder->isOpened()) {
+            delete encoder;
+            return;
+        }
+    }
+    cv::Mat keyframe;
+    int keyframeIndex = -1;
+    int keyframeCount = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < animation.frames; frame++) {
+        double t = animation.frames > 1 ? (double)frame / (animation.frames - 1) : 0;
+        double frameLogZoom = logZoom * t;
+        // A tiny epsilon keeps frames that land exactly on a keyframe from picking the previous one
+        int neededKeyframe = (int)floor(frameLogZoom / logKeyframeZoom + 1e-9);
+        if (neededKeyframe != keyframeIndex) {
+            keyframeIndex = neededKeyframe;
+            cpp_dec_float_deep scale = animation.startScale / pow(cpp_dec_float_deep(animation.keyframeScale), keyframeIndex);
+            cpp_dec_float_deep halfWidth = scale / 2;
+            cpp_dec_float_deep halfHeight = halfWidth * frameHeight / frameWidth;
+            RE_START_HP = animation.targetReal - halfWidth;
+            RE_END_HP = animation.targetReal + halfWidth;
+            IM_START_HP = animation.targetImag - halfHeight;
+            IM_END_HP = animation.targetImag + halfHeight;
+            IMAGE_WIDTH = (int)lround(frameWidth * animation.keyframeScale);
+            IMAGE_HEIGHT = (int)lround(frameHeight * animation.keyframeScale);
+            IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
 
-    colorManager->paint(iters, pixels);
+            cout << "\nKeyframe " << keyframeIndex << " (" << IMAGE_WIDTH << "x" << IMAGE_HEIGHT << ")\n";
+            CAPTURED_IMAGE = &keyframe;
+            createMandelbrotSetHP();
+            CAPTURED_IMAGE = nullptr;
+            keyframeCount++;
+        }
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Coloring: " << duration.count() << " ms" << endl;
-    start = chrono::high_resolution_clock::now();
+        // The frame covers 1 / ratio of the keyframe, ratio is between 1 and keyframeScale
+        double ratio = exp(frameLogZoom - keyframeIndex * logKeyframeZoom);
+        // The crop keeps the parity of the keyframe size so it stays exactly centred. It is never smaller
+        // than the frame, INTER_AREA averages every keyframe pixel a frame pixel covers instead of point sampling.
+        int cropWidth = keyframe.cols - 2 * (int)lround((keyframe.cols - keyframe.cols / ratio) / 2);
+        int cropHeight = keyframe.rows - 2 * (int)lround((keyframe.rows - keyframe.rows / ratio) / 2);
+        cv::Rect crop((keyframe.cols - cropWidth) / 2, (keyframe.rows - cropHeight) / 2, cropWidth, cropHeight);
+        cv::Mat image;
+        cv::resize(keyframe(crop), image, cv::Size(frameWidth, frameHeight), 0, 0, cv::INTER_AREA);
 
-    delete[] iters;
+        if (encoder != nullptr) {
+            encoder->push(image);
+            continue;
+        }
+        char frameFileName[1024];
+        snprintf(frameFileName, sizeof(frameFileName), animation.framePattern.c_str(), frame);
+        writeImage(image, frameFileName, COMPRESSION_LEVEL);
+    }
+    if (encoder != nullptr) {
+        auto encodingStart = chrono::high_resolution_clock::now();
+        encoder->finish();
+        cout << "\nWaiting for the encoder: " << elapsedMs(encodingStart) << " ms, " << encoder->getEncodedFrames() << " frames encoded" << endl;
+        delete encoder;
+    }
+    double totalMs = elapsedMs(start);
 
-    createColorImage(pixels);
+    IMAGE_WIDTH = frameWidth;
+    IMAGE_HEIGHT = frameHeight;
+    IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
+    cout << "\nAnimation: " << animation.frames << " frames from " << keyframeCount << " keyframes in " << totalMs
+        << " ms (" << totalMs / max(animation.frames, 1) << " ms per frame)" << endl;
+}
+
+// Precision of a batch job given by name or by its command line number, -1 when unknown
+int parsePrecision(const string& precision) {
+    for (int i = 0; i <= PRECISION_FLOAT; i++) {
+        if (precision == PRECISION_NAMES[i] || precision == to_string(i)) {
+            return i;
+        }
+    }
+    return precision == "auto" ? PRECISION_AUTO : -1;
+}
 
-    delete[] pixels;
+// Renders the jobs of a manifest one after another on the warm engine. Writing the image files, the part
+// that does not need the device, runs for up to concurrency jobs at once. A job is skipped when its output
+// exists next to a .hash file holding the same parameter hash.
+void runBatch(const string& manifestFile, int concurrency, const string& reportFile) {
+    vector<BatchJob> jobs = readBatchManifest(manifestFile);
+    stringstream settings;
+    settings << AA_SAMPLES << "|" << AA_THRESHOLD << "|" << DISTANCE_ESTIMATION << "|" << DE_BOUNDARY_WIDTH << "|" << COMPRESSION_LEVEL
+        << "|" << formulaName(FORMULA);
 
-    end = chrono::high_resolution_clock::now();
-    duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Image building: " << duration.count() << " ms" << endl;
+    vector<BatchJobResult> results;
+    deque<pair<size_t, future<double>>> writes;
+    auto finishWrite = [&]() {
+        results[writes.front().first].writeMs = writes.front().second.get();
+        writes.pop_front();
+    };
+    USE_HIGH_PRECISSION = true;
+    // Jobs differing from the one before only in the palette recolour its iterations,
+    // anti-aliasing and distance estimation paint more than the iterations
+    bool reuseIterations = AA_SAMPLES == 1 && !DISTANCE_ESTIMATION;
+    KEEP_ITERATIONS = reuseIterations;
+    string lastComputeKey;
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t jobIndex = 0; jobIndex < jobs.size(); jobIndex++) {
+        const BatchJob& job = jobs[jobIndex];
+        if (!job.error.empty()) {
+            cerr << "Skipping job " << jobIndex + 1 << " of " << manifestFile << ": " << job.error << endl;
+            results.push_back({ job, BATCH_JOB_INVALID, RenderStats(), 0 });
+            continue;
+        }
+        string hash = batchJobHash(job, settings.str());
+        string existingHash;
+        ifstream(job.output + ".hash") >> existingHash;
+        if (existingHash == hash && ifstream(job.output).good()) {
+            cout << "\nSkipping " << job.output << ", already rendered with the same parameters" << endl;
+            results.push_back({ job, BATCH_JOB_SKIPPED, RenderStats(), 0 });
+            continue;
+        }
 
+        int precision = parsePrecision(job.precision);
+        if (precision < 0 || job.paletteId < 0 || job.paletteId >= (int)palettes.size() || job.paletteLength < 1
+            || job.maxIter < 1 || job.width < 1 || job.height < 1) {
+            cerr << "Skipping " << job.output << ": invalid parameters" << endl;
+            results.push_back({ job, BATCH_JOB_INVALID, RenderStats(), 0 });
+            continue;
+        }
+        try {
+            RE_START_HP = cpp_dec_float_deep(job.reStart);
+            RE_END_HP = cpp_dec_float_deep(job.reEnd);
+            IM_START_HP = cpp_dec_float_deep(job.imStart);
+            IM_END_HP = cpp_dec_float_deep(job.imEnd);
+        }
+        catch (const exception& e) {
+            cerr << "Skipping " << job.output << ": invalid viewport" << endl;
+            results.push_back({ job, BATCH_JOB_INVALID, RenderStats(), 0 });
+            continue;
+        }
+        PRECISION_MODE = precision;
+        MAX_ITER = job.maxIter;
+        PALETTE_LENGTH = job.paletteLength;
+        PALETTE_ID = job.paletteId;
+        IMAGE_WIDTH = job.width;
+        IMAGE_HEIGHT = job.height;
+        IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT;
+        delete colorManager;
+        colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[PALETTE_ID], PALETTE_LENGTH);
+        // Checked here, createMandelbrotSetHP would end the whole batch. Float and double keep the double path.
+        if (DISTANCE_ESTIMATION && precision != PRECISION_DOUBLE && precision != PRECISION_FLOAT && !fixedPointResolvesPixels()) {
+            cerr << "Skipping " << job.output << ": distance estimation cannot resolve a pixel spacing below 2^-"
+                << FIXED_POINT_FRACTION_BITS << endl;
+            results.push_back({ job, BATCH_JOB_INVALID, RenderStats(), 0 });
+            continue;
+        }
+
+        stringstream computeKey;
+        computeKey << job.reStart << "|" << job.reEnd << "|" << job.imStart << "|" << job.imEnd << "|" << precision
+            << "|" << job.maxIter << "|" << job.width << "|" << job.height;
+
+        cout << "\nJob " << jobIndex + 1 << " of " << jobs.size() << ": " << job.output << "\n";
+        cv::Mat image;
+        CAPTURED_IMAGE = &image;
+        RenderStats stats;
+        if (reuseIterations && computeKey.str() == lastComputeKey) {
+            cout << "Recolouring the iterations of the previous job\n";
+            stats = recolorIterations(LAST_ITERATIONS.data());
+        }
+        else {
+            stats = createMandelbrotSetHP();
+            lastComputeKey = computeKey.str();
+        }
+        CAPTURED_IMAGE = nullptr;
+
+        if ((int)writes.size() >= concurrency) {
+            finishWrite();
+        }
+        results.push_back({ job, BATCH_JOB_RENDERED, stats, 0 });
+        writes.push_back({ results.size() - 1, async(launch::async, [image, job, hash]() {
+            auto writeStart = chrono::high_resolution_clock::now();
+            if (writeImage(image, job.output, COMPRESSION_LEVEL)) {
+                ofstream(job.output + ".hash") << hash << "\n";
+            }
+            return elapsedMs(writeStart);
+        }) });
+    }
+    while (!writes.empty()) {
+        finishWrite();
+    }
+    KEEP_ITERATIONS = false;
+    LAST_ITERATIONS = vector<int>();
+
+    int counts[3] = { 0, 0, 0 };
+    for (const BatchJobResult& result : results) {
+        counts[result.status]++;
+    }
+    cout << "\nBatch: " << counts[BATCH_JOB_RENDERED] << " rendered, " << counts[BATCH_JOB_SKIPPED] << " skipped, "
+        << counts[BATCH_JOB_INVALID] << " invalid in " << elapsedMs(start) << " ms" << endl;
+    if (!reportFile.empty()) {
+        writeBatchReport(results, reportFile);
+    }
+}
+
+// One of UTILIZE_OPENCL_*, -1 for an unknown name
+int parseDeviceType(const string& type) {
+    if (type == "cpu") {
+        return UTILIZE_OPENCL_CPU;
+    }
+    if (type == "gpu") {
+        return UTILIZE_OPENCL_GPU;
+    }
+    if (type == "acc") {
+        return UTILIZE_OPENCL_ACC;
+    }
+    return -1;
 }
 
 // Command line arguments:
-// HIGHG_PRECISION
+// PRECISION_MODE (0 - double, 1 - automatic, 2 - double-double, 3 - fixed point, 4 - perturbation, 5 - float)
 // RE_START, RE_END, IM_START, IM_END,
 // OUTPUT_FILENAME
 // MAX_ITER
 // PALETTE_LENGTH
+// PALETTE_ID
+//
+// Options, accepted anywhere on the command line:
+// --platform NAME              OpenCL platform name substring
+// --device cpu|gpu|acc[,...]   OpenCL device type, several are only used by --benchmark
+// --benchmark FILE             render the benchmark viewports and write .json or .csv results
+// --benchmark-runs N           runs per viewport, precision and device after a discarded warm-up run (default 5)
+// --compare FILE               diff every backend against the host references on the comparison viewports, print the
+//                              report and write it as .json or .csv, exit code 3 when a backend fails, Mandelbrot set only
+// --compare-target PLATFORM:TYPE   OpenCL target to compare, repeatable, e.g. "Portable Computing Language:cpu" for PoCL
+//                              (default the --platform with every --device)
+// --compare-tolerance N        escape iteration difference still counted as agreeing (default 1)
+// --batch FILE                 render the jobs of a .json or .csv manifest, see BatchJob for the fields
+// --batch-jobs N               jobs whose image files are written at the same time (default 2)
+// --batch-report FILE          write per job phase times as .json or .csv
+// --shared-frame FILE          publish the image to a memory-mapped frame ring buffer instead of OUTPUT_FILENAME
+// --compression N              deflate level 0 - 9 of .png and .tif output, .ppm and .bmp are always uncompressed
+// --cancel-file FILE           abandon the render between kernel launches once FILE exists, exit code 2
+// --preview                    let automatic precision use float up to its full mantissa, for quick low-quality passes
+// --formula F                  mandelbrot, multibrot:D, burning-ship[:D] or julia:RE,IM[,D], powers up to 8, double precision only
+// --distance                   colour by the exterior distance estimate, uses fixed point instead of double-double and perturbation
+//                              and refuses pixel spacings below 2^-88
+// --distance-width W           pixels from the boundary the distance palette runs over (default 8)
+// --omp-places close|spread|none   pin OpenMP threads to CPUs filling one NUMA node first or alternating nodes (default none)
+// --node-stats                 print mapping and coloring throughput per NUMA node
+// --huge-pages                 back the frame arena with huge pages where the system grants them
+// --focus X,Y                  render tiles nearest to this point first, fractions of the image from the top left (default 0.5,0.5)
+// --trace FILE                 write OpenCL command timestamps as a Chrome trace (chrome://tracing)
+// --workload-stats             print iteration totals, escape histogram and work-group divergence
+// --heatmap FILE               write an image of the per-pixel iteration cost
+// --save-iterations FILE       also save the escape iterations as an .mbi iteration map, not with --distance
+// --recolor FILE               paint an .mbi iteration map instead of rendering, only the output and palette arguments apply
+// --aa N                       N samples (4, 9 or 16) for pixels on edges, double precision only
+// --aa-threshold T             escape iteration difference to a neighbour that marks an edge (default 2)
+// --chunk K                    iterate double precision in launches of K iterations, re-launching unfinished pixels only
+// --zoom-frames N              render a zoom animation of N frames instead of a single image, using:
+// --zoom-target-re X, --zoom-target-im Y   point to zoom into
+// --zoom-start S, --zoom-end S width of the real axis in the first and last frame (default 3 and 1e-10)
+// --keyframe-scale F           zoom factor between rendered keyframes (default 2)
+// --frame-pattern PATTERN      printf pattern of the frame files (default ./frame_%05d.png)
+// --video TARGET               encode the frames into a video file, or "|COMMAND" to pipe raw bgr24 frames to an encoder
+// --video-fps F                frames per second of the video (default 30)
+// --video-queue N              frames buffered for the encoder thread (default 8)
 int main(int argc, char* argv[]) {
+    string platform = "NVIDIA CUDA";
+    vector<unsigned int> deviceTypes = { UTILIZE_OPENCL_GPU };
+    string benchmarkFile;
+    int benchmarkRuns = 5;
+    string compareFile;
+    vector<pair<string, unsigned int>> compareTargets;
+    int compareTolerance = 1;
+    string batchFile;
+    int batchJobs = 2;
+    string batchReportFile;
+    string traceFile;
+    string recolorFile;
+    float focus[2] = { 0.5f, 0.5f };
+    string ompPlaces = "none";
+    ZoomAnimation animation;
+    animation.targetReal = cpp_dec_float_deep("-0.743643887037158704752191506114774");
+    animation.targetImag = cpp_dec_float_deep("0.131825904205311970493132056385139");
+    animation.startScale = 3;
+    animation.endScale = cpp_dec_float_deep("1e-10");
+
+    vector<char*> positional;
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(argv[i]);
+            continue;
+        }
+        if (arg == "--workload-stats") {
+            WORKLOAD_STATS = true;
+            continue;
+        }
+        if (arg == "--node-stats") {
+            NODE_THROUGHPUT = true;
+            continue;
+        }
+        if (arg == "--huge-pages") {
+            frameArena().setHugePages(true);
+            continue;
+        }
+        if (arg == "--distance") {
+            DISTANCE_ESTIMATION = true;
+            continue;
+        }
+        if (arg == "--preview") {
+            PREVIEW = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return 1;
+        }
+        string value = argv[++i];
+        try {
+            if (arg == "--platform") {
+                platform = value;
+            }
+            else if (arg == "--device") {
+                deviceTypes.clear();
+                stringstream types(value);
+                string type;
+                while (getline(types, type, ',')) {
+                    int deviceType = parseDeviceType(type);
+                    if (deviceType < 0) {
+                        cerr << "Unknown device type " << type << endl;
+                        return 1;
+                    }
+                    deviceTypes.push_back(deviceType);
+                }
+            }
+            else if (arg == "--benchmark") {
+                benchmarkFile = value;
+            }
+            else if (arg == "--benchmark-runs") {
+                benchmarkRuns = stoi(value);
+            }
+            else if (arg == "--compare") {
+                compareFile = value;
+            }
+            else if (arg == "--compare-target") {
+                size_t colon = value.rfind(':');
+                int deviceType = colon == string::npos ? -1 : parseDeviceType(value.substr(colon + 1));
+                if (deviceType < 0) {
+                    cerr << "Expected PLATFORM:cpu|gpu|acc for --compare-target, got " << value << endl;
+                    return 1;
+                }
+                compareTargets.push_back({ value.substr(0, colon), deviceType });
+            }
+            else if (arg == "--compare-tolerance") {
+                compareTolerance = stoi(value);
+            }
+            else if (arg == "--batch") {
+                batchFile = value;
+            }
+            else if (arg == "--batch-jobs") {
+                batchJobs = stoi(value);
+            }
+            else if (arg == "--batch-report") {
+                batchReportFile = value;
+            }
+            else if (arg == "--shared-frame") {
+                SHARED_FRAME_FILENAME = value;
+            }
+            else if (arg == "--omp-places") {
+                ompPlaces = value;
+            }
+            else if (arg == "--formula") {
+                if (!parseFormula(value, FORMULA)) {
+                    cerr << "Unknown formula " << value << endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--distance-width") {
+                DE_BOUNDARY_WIDTH = stof(value);
+            }
+            else if (arg == "--focus") {
+                size_t comma = value.find(',');
+                if (comma == string::npos) {
+                    return 1;
+                }
+                focus[0] = stof(value.substr(0, comma));
+                focus[1] = stof(value.substr(comma + 1));
+            }
+            else if (arg == "--cancel-file") {
+                CANCEL_FILENAME = value;
+            }
+            else if (arg == "--compression") {
+                COMPRESSION_LEVEL = stoi(value);
+            }
+            else if (arg == "--trace") {
+                traceFile = value;
+            }
+            else if (arg == "--heatmap") {
+                HEATMAP_FILENAME = value;
+            }
+            else if (arg == "--save-iterations") {
+                SAVE_ITERATIONS_FILENAME = value;
+            }
+            else if (arg == "--recolor") {
+                recolorFile = value;
+            }
+            else if (arg == "--aa") {
+                AA_SAMPLES = stoi(value);
+            }
+            else if (arg == "--aa-threshold") {
+                AA_THRESHOLD = stoi(value);
+            }
+            else if (arg == "--zoom-frames") {
+                animation.frames = stoi(value);
+            }
+            else if (arg == "--zoom-target-re") {
+                animation.targetReal = cpp_dec_float_deep(value);
+            }
+            else if (arg == "--zoom-target-im") {
+                animation.targetImag = cpp_dec_float_deep(value);
+            }
+            else if (arg == "--zoom-start") {
+                animation.startScale = cpp_dec_float_deep(value);
+            }
+            else if (arg == "--zoom-end") {
+                animation.endScale = cpp_dec_float_deep(value);
+            }
+            else if (arg == "--keyframe-scale") {
+                animation.keyframeScale = stod(value);
+            }
+            else if (arg == "--frame-pattern") {
+                animation.framePattern = value;
+            }
+            else if (arg == "--video") {
+                animation.videoTarget = value;
+            }
+            else if (arg == "--video-fps") {
+                animation.videoFps = stod(value);
+            }
+            else if (arg == "--video-queue") {
+                animation.videoQueue = stoi(value);
+            }
+            else if (arg == "--chunk") {
+                CHUNK_ITERATIONS = stoi(value);
+            }
+            else {
+                cerr << "Unknown option " << arg << endl;
+                return 1;
+            }
+        }
+        catch (const invalid_argument& e) {
+            return 1;
+        }
+    }
+    argc = positional.size();
+    argv = positional.data();
+    int aaGrid = (int)lround(sqrt((double)AA_SAMPLES));
+    if (deviceTypes.empty() || benchmarkRuns < 1 || compareTolerance < 0 || batchJobs < 1 || CHUNK_ITERATIONS < 0 || DE_BOUNDARY_WIDTH <= 0 || COMPRESSION_LEVEL < 0 || COMPRESSION_LEVEL > 9 || AA_SAMPLES < 1 || aaGrid * aaGrid != AA_SAMPLES
+        || animation.frames < 0 || animation.keyframeScale <= 1 || animation.startScale <= 0 || animation.endScale <= 0
+        || animation.videoFps <= 0 || animation.videoQueue < 1) {
+        return 1;
+    }
+    if (!isMandelbrot(FORMULA)) {
+        // The distance and chunked kernels only iterate the Mandelbrot set
+        if (DISTANCE_ESTIMATION || CHUNK_ITERATIONS > 0) {
+            cerr << "--distance and --chunk only support the Mandelbrot set" << endl;
+            return 1;
+        }
+        cout << "Formula: " << formulaName(FORMULA) << "\n";
+        setKernelFormula(formulaBuildOptions(FORMULA));
+    }
+    if (DISTANCE_ESTIMATION && !SAVE_ITERATIONS_FILENAME.empty()) {
+        cout << "--save-iterations is ignored with --distance\n";
+    }
+    if (!pinOpenmpThreads(ompPlaces)) {
+        cerr << "Unknown --omp-places " << ompPlaces << endl;
+        return 1;
+    }
+    setOpenclTarget(platform, deviceTypes[0]);
+    if (!CANCEL_FILENAME.empty()) {
+        setCancellationCheck(cancelFileExists);
+    }
+    // Image rows run from IM_END at the top, kernel rows from IM_START
+    setRenderFocus(focus[0], 1 - focus[1]);
+    // Distance estimation renders probes and pixel lists, which are no partial images
+    if (!SHARED_FRAME_FILENAME.empty() && animation.frames == 0 && !DISTANCE_ESTIMATION) {
+        setProgressCallback(publishPartialFrame);
+    }
+
+    if (!benchmarkFile.empty()) {
+        runBenchmark(benchmarkFile, benchmarkRuns, platform, deviceTypes);
+        if (!traceFile.empty()) {
+            writeChromeTrace(traceFile);
+        }
+        return 0;
+    }
+
+    if (!compareFile.empty()) {
+        // The references iterate the Mandelbrot set with the plain escape radius
+        if (!isMandelbrot(FORMULA) || DISTANCE_ESTIMATION) {
+            cerr << "--compare does not support --formula or --distance" << endl;
+            return 1;
+        }
+        if (compareTargets.empty()) {
+            for (unsigned int deviceType : deviceTypes) {
+                compareTargets.push_back({ platform, deviceType });
+            }
+        }
+        bool passed = runComparison(compareFile, compareTolerance, compareTargets);
+        if (!traceFile.empty()) {
+            writeChromeTrace(traceFile);
+        }
+        return passed ? 0 : EXIT_COMPARISON_FAILED;
+    }
+
+    if (!batchFile.empty()) {
+        runBatch(batchFile, batchJobs, batchReportFile);
+        if (!traceFile.empty()) {
+            writeChromeTrace(traceFile);
+        }
+        return 0;
+    }
+
     if (argc > 1) {
         try {
-            USE_HIGH_PRECISSION = stod(argv[1]);
+            PRECISION_MODE = stoi(argv[1]);
+            if (PRECISION_MODE < PRECISION_DOUBLE || PRECISION_MODE > PRECISION_FLOAT) {
+                return 1;
+            }
+            USE_HIGH_PRECISSION = PRECISION_MODE != PRECISION_DOUBLE;
         }
         catch (const invalid_argument& e) {
             return 1;
         }
         try {
             if (USE_HIGH_PRECISSION) {
-                RE_START_HP = cpp_dec_float_50(argv[2]);
+                RE_START_HP = cpp_dec_float_deep(argv[2]);
             }
             else {
                 RE_START = stod(argv[2]);
@@ -310,7 +1861,7 @@ int main(int argc, char* argv[]) {
         }
         try {
             if (USE_HIGH_PRECISSION) {
-                RE_END_HP = cpp_dec_float_50(argv[3]);
+                RE_END_HP = cpp_dec_float_deep(argv[3]);
             }
             else {
                 RE_END = stod(argv[3]);
@@ -321,7 +1872,7 @@ int main(int argc, char* argv[]) {
         }
         try {           
             if (USE_HIGH_PRECISSION) {
-                IM_START_HP = cpp_dec_float_50(argv[4]);
+                IM_START_HP = cpp_dec_float_deep(argv[4]);
             }
             else {
                 IM_START = stod(argv[4]);
@@ -332,7 +1883,7 @@ int main(int argc, char* argv[]) {
         }
         try {
             if (USE_HIGH_PRECISSION) {
-                IM_END_HP = cpp_dec_float_50(argv[5]);
+                IM_END_HP = cpp_dec_float_deep(argv[5]);
             }
             else {
                 IM_END = stod(argv[5]);
@@ -359,6 +1910,7 @@ int main(int argc, char* argv[]) {
             if (paletteId < 0 || paletteId >= palettes.size()) {
                 return 1;
             }
+            PALETTE_ID = paletteId;
             //colorManager = new ExponentialColorPalette(IMAGE_SIZE, MAX_ITER, colors2, PALETTE_LENGTH);
             colorManager = new CyclicColorPalette(IMAGE_SIZE, palettes[paletteId], PALETTE_LENGTH);
         }
@@ -366,10 +1918,19 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
-    if (USE_HIGH_PRECISSION) {
+    if (!recolorFile.empty()) {
+        return recolorIterationMap(recolorFile);
+    }
+    if (animation.frames > 0) {
+        runZoomAnimation(animation);
+    }
+    else if (USE_HIGH_PRECISSION) {
         createMandelbrotSetHP();
     }
     else {
         createMandelbrotSet();
     }
+    if (!traceFile.empty() && !writeChromeTrace(traceFile)) {
+        cerr << "Could not write " << traceFile << endl;
+    }
 }
\ No newline at end of file
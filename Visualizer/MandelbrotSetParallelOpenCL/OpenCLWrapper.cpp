@@ -3,6 +3,12 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <chrono>
+#include <map>
+#include <set>
+#include <sstream>
+#include <algorithm>
 
 #include <CL/cl.h>
 
@@ -33,9 +39,34 @@ typedef struct {
 //#endif
 #define OPENCL_TARGET_PLATFORM "NVIDIA CUDA"
 
-#define UTILIZE_OPENCL_CPU 0
-#define UTILIZE_OPENCL_GPU 1
-#define UTILIZE_OPENCL_ACC 2
+string targetPlatform = OPENCL_TARGET_PLATFORM;
+unsigned int targetDeviceType = UTILIZE_OPENCL_GPU;
+string selectedDeviceName;
+
+void releaseOpenclEngine();
+
+void setOpenclTarget(const string& platformSubname, unsigned int deviceType) {
+	if (platformSubname != targetPlatform || deviceType != targetDeviceType) {
+		releaseOpenclEngine();
+	}
+	targetPlatform = platformSubname;
+	targetDeviceType = deviceType;
+}
+
+string getOpenclDeviceName() {
+	return selectedDeviceName;
+}
+
+// Tuned work-group shapes, one line per device and viewport class: "width height key"
+const char* WORK_GROUP_SHAPES_FILE = "work_group_shapes.txt";
+map<string, pair<size_t, size_t>> workGroupShapes;
+bool workGroupShapesLoaded = false;
+size_t lastWorkGroupShape[2] = { 1, 1 };
+
+void getWorkGroupShape(unsigned int shape[2]) {
+	shape[0] = lastWorkGroupShape[0];
+	shape[1] = lastWorkGroupShape[1];
+}
 
 // Error handling strategy for this example is fairly simple -- just print
 // a message and terminate the application if something goes wrong
@@ -50,6 +81,92 @@ typedef struct {
 	exit(1);                               \
 }
 
+vector<ProfilingRecord> profilingRecords;
+
+unsigned long long hostTimeNs() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Host-side work (device setup, program build) has no event, it is timed on the host
+void recordHostPhase(const char* name, int category, unsigned long long startNs) {
+	unsigned long long endNs = hostTimeNs();
+	profilingRecords.push_back({ name, category, false, startNs, startNs, startNs, endNs });
+}
+
+// Waits for the event and stores its timestamps. Device clocks are shifted so the
+// queued time matches the host time of the enqueue call, which puts host and device
+// records on one timeline.
+void recordEvent(cl_event event, const char* name, int category, unsigned long long hostEnqueueNs) {
+	cl_ulong queued, submit, start, end;
+	cl_int err = clWaitForEvents(1, &event);
+	SIMPLE_CHECK_ERRORS(err);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &submit, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	clReleaseEvent(event);
+	profilingRecords.push_back({
+		name, category, true,
+		hostEnqueueNs,
+		hostEnqueueNs + (submit - queued),
+		hostEnqueueNs + (start - queued),
+		hostEnqueueNs + (end - queued)
+	});
+}
+
+size_t getProfilingRecordCount() {
+	return profilingRecords.size();
+}
+
+const ProfilingRecord& getProfilingRecord(size_t index) {
+	return profilingRecords[index];
+}
+
+void printProfilingRecords(size_t first) {
+	cout << "\nDevice profile:\n";
+	for (size_t i = first; i < profilingRecords.size(); i++) {
+		const ProfilingRecord& record = profilingRecords[i];
+		cout << "    " << record.name << ": ";
+		if (record.device) {
+			cout << "waited " << (record.startNs - record.queuedNs) / 1e6 << " ms, ";
+		}
+		cout << "ran " << (record.endNs - record.startNs) / 1e6 << " ms\n";
+	}
+}
+
+// Chrome trace event format, loadable in chrome://tracing or Perfetto.
+// Host phases and device execution go on separate threads, device commands
+// additionally show the time they spent queued before starting.
+bool writeChromeTrace(const string& fileName) {
+	ofstream out(fileName);
+	if (!out) {
+		return false;
+	}
+	unsigned long long origin = profilingRecords.empty() ? 0 : profilingRecords.front().queuedNs;
+	for (const ProfilingRecord& record : profilingRecords) {
+		origin = min(origin, record.queuedNs);
+	}
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	auto writeEvent = [&](const string& name, int tid, unsigned long long startNs, unsigned long long endNs) {
+		out << (first ? "" : ",\n")
+			<< "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			<< ",\"ts\":" << (startNs - origin) / 1000.0 << ",\"dur\":" << (endNs - startNs) / 1000.0 << "}";
+		first = false;
+	};
+	for (const ProfilingRecord& record : profilingRecords) {
+		if (record.device) {
+			writeEvent(record.name + " (queued)", 2, record.queuedNs, record.startNs);
+			writeEvent(record.name, 3, record.startNs, record.endNs);
+		}
+		else {
+			writeEvent(record.name, 1, record.startNs, record.endNs);
+		}
+	}
+	out << "\n],\n\"displayTimeUnit\":\"ms\"}\n";
+	return true;
+}
+
 OpenclDeviceSetupInfo setupOpenclDevices(){
 	// The following variable stores return codes for all OpenCL calls
 // In the code it is used with SIMPLE_CHECK_ERRORS macro
@@ -74,7 +191,7 @@ OpenclDeviceSetupInfo setupOpenclDevices(){
 	// We use platform name to select needed platform
 
 	// Default substring for platform name
-	const char* required_platform_subname = OPENCL_TARGET_PLATFORM;
+	const char* required_platform_subname = targetPlatform.c_str();
 
 	cl_uint selected_platform_index = num_of_platforms;
 
@@ -181,7 +298,7 @@ OpenclDeviceSetupInfo setupOpenclDevices(){
 	// 5. Get all devices IDs of specific type: GPU/CPU/ACCELERATOR
 	// We are going to use the GPU, CPU, or ACCELERATOR, NOT ALL at the same time
 
-	const unsigned int device_type = UTILIZE_OPENCL_GPU;
+	const unsigned int device_type = targetDeviceType;
 	cl_uint device_num = all_devices[device_type].count;
 	cl_device_id* devices = (cl_device_id*)malloc(sizeof(cl_device_id) * device_num);
 
@@ -199,6 +316,9 @@ OpenclDeviceSetupInfo setupOpenclDevices(){
 		char deviceName[128];
 		clGetDeviceInfo(devices[j], CL_DEVICE_NAME, 128, deviceName, nullptr);
 		std::cout << "Device: " << deviceName << std::endl;
+		if (j == 0) {
+			selectedDeviceName = deviceName;
+		}
 
 		char openclVersion[128];
 		clGetDeviceInfo(devices[j], CL_DEVICE_VERSION, 128, openclVersion, nullptr);
@@ -224,11 +344,13 @@ OpenclDeviceSetupInfo setupOpenclDevices(){
 	// -----------------------------------------------------------------------
 	// 7. Create command queue(s) and add device(s)
 
+	// Profiling lets every enqueued command report its queued, submit, start and end times
+	cl_queue_properties queue_properties[] = { CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0 };
 	cl_command_queue cmd_queue;
 	cmd_queue = clCreateCommandQueueWithProperties(
 		context,				/* context */
 		*devices,				/* devices[0] */
-		NULL,					/* properties */
+		queue_properties,		/* properties */
 		&err					/* errcode_ret */
 	);
 
@@ -242,6 +364,34 @@ OpenclDeviceSetupInfo setupOpenclDevices(){
 	return output;
 }
 
+// The context, queue and built programs are kept between renders ("warm engine"),
+// only the first render for a target pays for device setup and program builds
+OpenclDeviceSetupInfo engine;
+bool engineReady = false;
+map<string, cl_program> programs;
+
+void releaseOpenclEngine() {
+	if (!engineReady) {
+		return;
+	}
+	for (auto& program : programs) {
+		clReleaseProgram(program.second);
+	}
+	programs.clear();
+	clReleaseCommandQueue(engine.cmd_queue);
+	clReleaseContext(engine.context);
+	free(engine.devices);
+	engineReady = false;
+}
+
+OpenclDeviceSetupInfo acquireOpenclDevices() {
+	if (!engineReady) {
+		engine = setupOpenclDevices();
+		engineReady = true;
+	}
+	return engine;
+}
+
 // Used to print log file content in case of error
 // Log file may be empty despite error happening
 void printError(const cl_program& program, const cl_device_id& device) {
@@ -259,9 +409,386 @@ void printError(const cl_program& program, const cl_device_id& device) {
 	printf("%s\n", log);
 }
 
-int calculateIters(Complex* points, int* iters, unsigned int size, unsigned int max_iter)
+// Builds the program from the given kernel file and build options, unless already built, and creates the named kernel
+cl_kernel createKernelFromFile(const OpenclDeviceSetupInfo& deviceInfo, const char* kernelFileName, const char* kernelName = "calculateIters",
+	const char* buildOptions = "") {
+	cl_int err = CL_SUCCESS;
+
+	// -----------------------------------------------------------------------
+	// 10. Create and compile OpenCL program, once per kernel file and options while the engine stays warm
+
+	cl_program program;
+	string programKey = string(kernelFileName) + "|" + buildOptions;
+	auto cached = programs.find(programKey);
+	if (cached != programs.end()) {
+		program = cached->second;
+	}
+	else {
+		ifstream kernelFileStream(kernelFileName);
+		std::string kernelSrcFileContent((std::istreambuf_iterator<char>(kernelFileStream)), std::istreambuf_iterator<char>());
+		const char* kernelSrc = kernelSrcFileContent.c_str();
+
+		// Create Progam object
+		program = clCreateProgramWithSource(
+			deviceInfo.context,					/* context */
+			1,									/* count */
+			&kernelSrc,							/* strings */
+			NULL,								/* lengths */
+			&err								/* errcode_ret */
+		);
+		SIMPLE_CHECK_ERRORS(err);
+
+		// Compile Program object
+		err = clBuildProgram(
+			program,			/* program */
+			1,					/* num_devices */
+			deviceInfo.devices,	/* device_list */
+			buildOptions,		/* options */
+			NULL,				/* pfn_notify */
+			NULL				/* user_data */
+		);
+		if (err != CL_SUCCESS) {
+			printError(program, deviceInfo.devices[0]);
+		}
+		SIMPLE_CHECK_ERRORS(err);
+		programs[programKey] = program;
+	}
+
+	// -----------------------------------------------------------------------
+	// 11. Create kernel
+
+	cl_kernel kernel = NULL;
+	kernel = clCreateKernel(
+		program,					/* program */
+		kernelName,					/* kernel_name - needs to match function name inside kernel */
+		&err						/* errcode_ret */
+	);
+	SIMPLE_CHECK_ERRORS(err);
+	return kernel;
+}
+
+// Escape iterations below this limit fit the 16-bit output, the two values above it stand for -1 and ITERS_NOT_COMPUTED
+#define COMPACT_ITERS_LIMIT 0xFFFE
+#define COMPACT_BUILD_OPTIONS "-D COMPACT_ITERS"
+
+bool compactIters(unsigned int max_iter) {
+	return max_iter <= COMPACT_ITERS_LIMIT;
+}
+
+size_t iterSize(bool compact) {
+	return compact ? sizeof(cl_ushort) : sizeof(cl_int);
+}
+
+vector<cl_ushort> compactReadBuffer;
+
+// Reads the output buffer into iters, 16-bit counts are widened on the host
+void readIterations(const OpenclDeviceSetupInfo& deviceInfo, cl_mem output, int* iters, size_t size, bool compact, const char* name) {
+	cl_event read_event;
+	unsigned long long readEnqueueNs = hostTimeNs();
+	void* target = iters;
+	if (compact) {
+		compactReadBuffer.resize(size);
+		target = compactReadBuffer.data();
+	}
+	cl_int err = clEnqueueReadBuffer(
+		deviceInfo.cmd_queue,	/* command_queue */
+		output,					/* buffer */
+		CL_TRUE,				/* blocking_read */
+		0,						/* offset */
+		iterSize(compact) * size,	/* size */
+		target,					/* ptr */
+		NULL,					/* num_events_in_wait_list */
+		NULL,					/* event_wait_list */
+		&read_event				/* event */
+	);
+	SIMPLE_CHECK_ERRORS(err);
+	recordEvent(read_event, name, PROFILE_TRANSFER, readEnqueueNs);
+	if (compact) {
+		#pragma omp parallel for
+		for (long long i = 0; i < (long long)size; i++) {
+			cl_ushort value = compactReadBuffer[i];
+			iters[i] = value > COMPACT_ITERS_LIMIT ? -1 : value == COMPACT_ITERS_LIMIT ? ITERS_NOT_COMPUTED : value;
+		}
+	}
+}
+
+size_t roundUp(size_t value, size_t multiple) {
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+// Edge of a square tile in pixels, rounded up to whole work-groups. Renders are launched tile by tile,
+// so they can be cancelled between launches and partial results can be shown early.
+#define TILE_SIZE 64
+// Partial results are handed to the progress callback after 1/16 and 1/4 of the tiles, nearest to the focus first
+#define PROGRESS_PASSES 3
+
+bool (*cancellationCheck)() = NULL;
+void (*progressCallback)(const int* iters, unsigned int width, unsigned int height) = NULL;
+float renderFocus[2] = { 0.5f, 0.5f };
+
+void setCancellationCheck(bool (*check)()) {
+	cancellationCheck = check;
+}
+
+bool renderCancelled() {
+	return cancellationCheck != NULL && cancellationCheck();
+}
+
+void setProgressCallback(void (*callback)(const int* iters, unsigned int width, unsigned int height)) {
+	progressCallback = callback;
+}
+
+void setRenderFocus(float x, float y) {
+	renderFocus[0] = x;
+	renderFocus[1] = y;
+}
+
+string kernelFormulaOptions;
+
+void setKernelFormula(const string& buildOptions) {
+	kernelFormulaOptions = buildOptions;
+}
+
+struct Tile {
+	size_t offset[2];
+	size_t size[2];
+	double distance;
+};
+
+// Tiles covering the padded image, sorted by the distance of their center from the focus point
+vector<Tile> tilesByPriority(unsigned int width, unsigned int height, const size_t local_work_size[2]) {
+	size_t tile_size[2] = { roundUp(TILE_SIZE, local_work_size[0]), roundUp(TILE_SIZE, local_work_size[1]) };
+	double focus[2] = { renderFocus[0] * width, renderFocus[1] * height };
+	vector<Tile> tiles;
+	for (size_t y = 0; y < height; y += tile_size[1]) {
+		for (size_t x = 0; x < width; x += tile_size[0]) {
+			Tile tile;
+			tile.offset[0] = x;
+			tile.offset[1] = y;
+			tile.size[0] = min(tile_size[0], roundUp(width - x, local_work_size[0]));
+			tile.size[1] = min(tile_size[1], roundUp(height - y, local_work_size[1]));
+			double dx = x + min<size_t>(tile.size[0], width - x) / 2.0 - focus[0];
+			double dy = y + min<size_t>(tile.size[1], height - y) / 2.0 - focus[1];
+			tile.distance = dx * dx + dy * dy;
+			tiles.push_back(tile);
+		}
+	}
+	stable_sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.distance < b.distance; });
+	return tiles;
+}
+
+// Launches the kernel tile by tile in priority order. The next tile is queued before waiting for the previous one,
+// so the device stays busy while the host polls the cancellation check and hands out partial results.
+// With a progress callback the output starts filled with ITERS_NOT_COMPUTED and is read back after every pass.
+// Returns CALCULATE_ITERS_CANCELLED when the check fired, tiles already queued finish first.
+int enqueueKernelTiles(const OpenclDeviceSetupInfo& deviceInfo, cl_kernel kernel, const char* name, cl_mem output, int* iters,
+	unsigned int width, unsigned int height, const size_t local_work_size[2], bool compact) {
+	vector<Tile> tiles = tilesByPriority(width, height, local_work_size);
+	size_t size = (size_t)width * height;
+	vector<size_t> passEnds;
+	if (progressCallback != NULL) {
+		cl_int not_computed = ITERS_NOT_COMPUTED;
+		cl_ushort not_computed_compact = COMPACT_ITERS_LIMIT;
+		const void* pattern = compact ? (const void*)&not_computed_compact : (const void*)&not_computed;
+		cl_int err = clEnqueueFillBuffer(deviceInfo.cmd_queue, output, pattern, iterSize(compact), 0, iterSize(compact) * size, 0, NULL, NULL);
+		SIMPLE_CHECK_ERRORS(err);
+		for (int pass = PROGRESS_PASSES - 1; pass >= 1; pass--) {
+			passEnds.push_back((tiles.size() + (1 << 2 * pass) - 1) >> (2 * pass));
+		}
+	}
+
+	size_t nextPass = 0;
+	cl_event previous_event = NULL;
+	unsigned long long previousEnqueueNs = 0;
+	for (size_t i = 0; i <= tiles.size(); i++) {
+		cl_event event = NULL;
+		unsigned long long enqueueNs = hostTimeNs();
+		if (i < tiles.size()) {
+			cl_int err = clEnqueueNDRangeKernel(deviceInfo.cmd_queue, kernel, 2, tiles[i].offset, tiles[i].size, local_work_size, 0, NULL, &event);
+			SIMPLE_CHECK_ERRORS(err);
+			clFlush(deviceInfo.cmd_queue);
+		}
+		if (previous_event == NULL) {
+			previous_event = event;
+			previousEnqueueNs = enqueueNs;
+			continue;
+		}
+		recordEvent(previous_event, name, PROFILE_KERNEL, previousEnqueueNs);
+		if (renderCancelled()) {
+			if (event != NULL) {
+				clWaitForEvents(1, &event);
+				clReleaseEvent(event);
+			}
+			return CALCULATE_ITERS_CANCELLED;
+		}
+		// The first i tiles are done, the read also waits for the tile queued above
+		if (nextPass < passEnds.size() && i >= passEnds[nextPass] && i < tiles.size()) {
+			readIterations(deviceInfo, output, iters, size, compact, "Read partial output");
+			progressCallback(iters, width, height);
+			while (nextPass < passEnds.size() && i >= passEnds[nextPass]) {
+				nextPass++;
+			}
+		}
+		previous_event = event;
+		previousEnqueueNs = enqueueNs;
+	}
+	return CL_SUCCESS;
+}
+
+// Work-group sizes of 32 to 256 work-items, rounded to the preferred multiple of the kernel, in several shapes
+vector<pair<size_t, size_t>> workGroupCandidates(const OpenclDeviceSetupInfo& deviceInfo, cl_kernel kernel) {
+	size_t maxSize = 0;
+	size_t multiple = 1;
+	cl_int err = clGetKernelWorkGroupInfo(kernel, deviceInfo.devices[0], CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxSize, NULL);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clGetKernelWorkGroupInfo(kernel, deviceInfo.devices[0], CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &multiple, NULL);
+	SIMPLE_CHECK_ERRORS(err);
+
+	vector<pair<size_t, size_t>> candidates;
+	// Several totals can round to the same size
+	set<pair<size_t, size_t>> added;
+	for (size_t total = 32; total <= 256; total *= 2) {
+		size_t size = roundUp(total, multiple);
+		if (size > maxSize) {
+			break;
+		}
+		for (size_t height = 1; height <= 8; height *= 2) {
+			if (size % height == 0 && added.insert({ size / height, height }).second) {
+				candidates.push_back({ size / height, height });
+			}
+		}
+	}
+	if (candidates.empty()) {
+		candidates.push_back({ maxSize, 1 });
+	}
+	return candidates;
+}
+
+void loadWorkGroupShapes() {
+	workGroupShapesLoaded = true;
+	ifstream in(WORK_GROUP_SHAPES_FILE);
+	size_t shapeWidth, shapeHeight;
+	string key;
+	while (in >> shapeWidth >> shapeHeight && getline(in >> ws, key)) {
+		workGroupShapes[key] = { shapeWidth, shapeHeight };
+	}
+}
+
+unsigned int ceilLog2(unsigned int value) {
+	unsigned int bits = 0;
+	while (bits < 32 && (1ull << bits) < value) {
+		bits++;
+	}
+	return bits;
+}
+
+// Names the kernel in the tuning key, every set of build options is a separate program and tuned separately
+string tuningLabel(const char* kernelFileName, const char* kernelName, const string& buildOptions) {
+	string label = kernelFileName;
+	if (string(kernelName) != "calculateIters") {
+		label += ":" + string(kernelName);
+	}
+	if (!buildOptions.empty()) {
+		label += "[" + buildOptions + "]";
+	}
+	return label;
+}
+
+// Candidates are timed on this many tiles nearest to the focus
+#define TUNING_TILES 2
+
+// Single-row launches (the anti-aliasing samples) are timed on a row as long as the tuning tiles together
+vector<Tile> tuningTiles(unsigned int width, unsigned int height) {
+	if (height == 1) {
+		Tile row = { { 0, 0 }, { min<size_t>(width, TILE_SIZE * TILE_SIZE * TUNING_TILES), 1 }, 0 };
+		return { row };
+	}
+	const size_t pixel[2] = { 1, 1 };
+	vector<Tile> tiles = tilesByPriority(width, height, pixel);
+	tiles.resize(min<size_t>(tiles.size(), TUNING_TILES));
+	return tiles;
+}
+
+// Picks the work-group shape for the kernel. The first launch of a device, kernel and max_iter class
+// (rounded up to a power of two) times every candidate on the tiles nearest to the focus, later launches
+// reuse the fastest shape, also across runs through WORK_GROUP_SHAPES_FILE. Single-row launches are a class of their own.
+// A cancelled tuning keeps the fastest shape so far for this launch only.
+void selectWorkGroupShape(const OpenclDeviceSetupInfo& deviceInfo, cl_kernel kernel, const string& kernelLabel,
+	unsigned int width, unsigned int height, unsigned int max_iter, size_t local_work_size[2]) {
+	if (!workGroupShapesLoaded) {
+		loadWorkGroupShapes();
+	}
+	stringstream key;
+	key << selectedDeviceName << "|" << kernelLabel << "|iterations 2^" << ceilLog2(max_iter);
+	if (height == 1) {
+		key << "|single row";
+	}
+
+	auto found = workGroupShapes.find(key.str());
+	pair<size_t, size_t> shape;
+	if (found != workGroupShapes.end()) {
+		shape = found->second;
+	}
+	else {
+		unsigned long long tuningStartNs = hostTimeNs();
+		cout << "Tuning work-group shape for " << key.str() << endl;
+		vector<pair<size_t, size_t>> candidates = workGroupCandidates(deviceInfo, kernel);
+		vector<Tile> tiles = tuningTiles(width, height);
+		shape = candidates.front();
+		cl_ulong bestNs = ~(cl_ulong)0;
+		bool cancelled = false;
+		for (const pair<size_t, size_t>& candidate : candidates) {
+			if (renderCancelled()) {
+				cancelled = true;
+				break;
+			}
+			size_t candidateShape[2] = { candidate.first, candidate.second };
+			cl_ulong candidateNs = 0;
+			for (const Tile& tile : tiles) {
+				size_t global_work_size[2] = { roundUp(tile.size[0], candidateShape[0]), roundUp(tile.size[1], candidateShape[1]) };
+				cl_event event;
+				cl_int err = clEnqueueNDRangeKernel(deviceInfo.cmd_queue, kernel, 2, tile.offset, global_work_size, candidateShape, 0, NULL, &event);
+				SIMPLE_CHECK_ERRORS(err);
+				err = clWaitForEvents(1, &event);
+				SIMPLE_CHECK_ERRORS(err);
+				cl_ulong start, end;
+				clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+				clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+				clReleaseEvent(event);
+				candidateNs += end - start;
+			}
+			cout << "    " << candidateShape[0] << "x" << candidateShape[1] << ": " << candidateNs / 1e6 << " ms\n";
+			if (candidateNs < bestNs) {
+				bestNs = candidateNs;
+				shape = candidate;
+			}
+		}
+		if (!cancelled) {
+			workGroupShapes[key.str()] = shape;
+			ofstream out(WORK_GROUP_SHAPES_FILE, ios::app);
+			out << shape.first << " " << shape.second << " " << key.str() << "\n";
+		}
+		recordHostPhase("Work-group tuning", PROFILE_BUILD, tuningStartNs);
+	}
+	local_work_size[0] = shape.first;
+	local_work_size[1] = shape.second;
+	lastWorkGroupShape[0] = local_work_size[0];
+	lastWorkGroupShape[1] = local_work_size[1];
+}
+
+// Runs the calculateIters kernel from the given file over an array of points.
+// All kernel variants share the same signature and differ only in the point type.
+// With distances set, the calculateDistances kernel of the file also writes the exterior distance estimate in pixels.
+// formulaOptions specialize the program, each set of options is built and tuned separately.
+int calculateItersWithKernel(const char* kernelFileName, const void* points, size_t pointSize, int* iters,
+	unsigned int width, unsigned int height, unsigned int max_iter, float* distances = NULL, double pixelSize = 0,
+	const string& formulaOptions = "")
 {
-	OpenclDeviceSetupInfo deviceInfo = setupOpenclDevices();
+	unsigned int size = width * height;
+	bool compact = compactIters(max_iter);
+	unsigned long long setupStartNs = hostTimeNs();
+	OpenclDeviceSetupInfo deviceInfo = acquireOpenclDevices();
+	recordHostPhase("Device setup", PROFILE_SETUP, setupStartNs);
 	cl_int err = deviceInfo.err;
 
 	// -----------------------------------------------------------------------
@@ -273,7 +800,7 @@ int calculateIters(Complex* points, int* iters, unsigned int size, unsigned int
 	device_buffer_input = clCreateBuffer(
 		deviceInfo.context,			/* context */
 		CL_MEM_READ_ONLY,			/* flags */
-		sizeof(Complex) * size,		/* size */
+		pointSize * size,			/* size */
 		NULL,						/* host_ptr */
 		&err						/* errcode_ret */
 	);
@@ -283,70 +810,50 @@ int calculateIters(Complex* points, int* iters, unsigned int size, unsigned int
 	device_buffer_output = clCreateBuffer(
 		deviceInfo.context,
 		CL_MEM_WRITE_ONLY,
-		sizeof(int) * size,
+		iterSize(compact) * size,
 		NULL,
 		&err
 	);
 
 	SIMPLE_CHECK_ERRORS(err);
 
+	cl_mem device_buffer_distances = NULL;
+	if (distances != NULL) {
+		device_buffer_distances = clCreateBuffer(deviceInfo.context, CL_MEM_WRITE_ONLY, sizeof(float) * size, NULL, &err);
+		SIMPLE_CHECK_ERRORS(err);
+	}
+
 	// -----------------------------------------------------------------------
 	// 9. Tranfer data from the host memory to the device memory
 
 	// Transfer data from host_buffer_A to device_buffer_A
+	cl_event write_event;
+	unsigned long long writeEnqueueNs = hostTimeNs();
 	err = clEnqueueWriteBuffer(
 		deviceInfo.cmd_queue,		/* command_queue */
 		device_buffer_input,		/* buffer */
 		CL_TRUE,					/* blocking_write */
 		0,							/* offset */
-		sizeof(Complex) * size,		/* size */
+		pointSize * size,			/* size */
 		points,						/* ptr */
 		NULL,						/* num_events_in_wait_list */
 		NULL,						/* event_wait_list */
-		NULL						/* event */
+		&write_event				/* event */
 	);
 
 	SIMPLE_CHECK_ERRORS(err);
+	recordEvent(write_event, "Write input", PROFILE_TRANSFER, writeEnqueueNs);
 
-	// -----------------------------------------------------------------------
-	// 10. Create and compile OpenCL program
-
-	ifstream kernelFileStream("kernel.cl");
-	std::string kernelSrcFileContent((std::istreambuf_iterator<char>(kernelFileStream)), std::istreambuf_iterator<char>());
-	const char* kernelSrc = kernelSrcFileContent.c_str();
-
-	// Create Progam object
-	cl_program program = clCreateProgramWithSource(
-		deviceInfo.context,					/* context */
-		1,									/* count */
-		&kernelSrc,							/* strings */
-		NULL,								/* lengths */
-		&err								/* errcode_ret */
-	);
-	SIMPLE_CHECK_ERRORS(err);
-
-	// Compile Program object
-	err = clBuildProgram(
-		program,			/* program */
-		1,					/* num_devices */
-		deviceInfo.devices,	/* device_list */
-		NULL,				/* options */
-		NULL,				/* pfn_notify */
-		NULL				/* user_data */
-	);
-	SIMPLE_CHECK_ERRORS(err);
-
-	// -----------------------------------------------------------------------
-	// 11. Create kernel
+	unsigned long long buildStartNs = hostTimeNs();
+	string buildOptions = compact ? COMPACT_BUILD_OPTIONS : "";
+	if (!formulaOptions.empty()) {
+		buildOptions += (buildOptions.empty() ? "" : " ") + formulaOptions;
+	}
+	const char* kernelName = distances != NULL ? "calculateDistances" : "calculateIters";
+	cl_kernel kernel = createKernelFromFile(deviceInfo, kernelFileName, kernelName, buildOptions.c_str());
+	recordHostPhase("Program build", PROFILE_BUILD, buildStartNs);
+	string kernelLabel = tuningLabel(kernelFileName, kernelName, buildOptions);
 
-	cl_kernel kernel = NULL;
-	kernel = clCreateKernel(
-		program,					/* program */
-		"calculateIters",			/* kernel_name - needs to match function name inside kernel */
-		&err						/* errcode_ret */
-	);	
-	
-	SIMPLE_CHECK_ERRORS(err);
 	// -----------------------------------------------------------------------
 	// 12. Set kernel function argument list
 
@@ -375,72 +882,227 @@ int calculateIters(Complex* points, int* iters, unsigned int size, unsigned int
 	);
 	SIMPLE_CHECK_ERRORS(err);
 
+	cl_uint width_kernel = width;
+	cl_uint height_kernel = height;
+	err = clSetKernelArg(kernel, 3, sizeof(cl_uint), &width_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 4, sizeof(cl_uint), &height_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	if (distances != NULL) {
+		cl_double pixel_size_kernel = pixelSize;
+		err = clSetKernelArg(kernel, 5, sizeof(cl_mem), &device_buffer_distances);
+		SIMPLE_CHECK_ERRORS(err);
+		err = clSetKernelArg(kernel, 6, sizeof(cl_double), &pixel_size_kernel);
+		SIMPLE_CHECK_ERRORS(err);
+	}
+
 	// -----------------------------------------------------------------------	
 	// 13. Define work-item and work-group
 
-	//size_t n_dim = 3;
-	//size_t global_work_size[3] = {data_size, 1, 1};
-	//size_t local_work_size[3]= {64, 1, 1};
-
-	size_t n_dim = 1;
-	size_t global_work_size[1] = { size };
-	size_t local_work_size[1] = { 100 };	// Maximum work size is 1024
+	size_t local_work_size[2];
+	selectWorkGroupShape(deviceInfo, kernel, kernelLabel, width, height, max_iter, local_work_size);
 
 	// -----------------------------------------------------------------------
-	// 14. Enqueue (run) the kernel(s)
+	// 14. Enqueue (run) the kernel(s), one tile at a time
 
-	err = clEnqueueNDRangeKernel(
-		deviceInfo.cmd_queue,	/* command_queue */
-		kernel,					/* kernel */
-		n_dim,					/* work_dim */
-		NULL,					/* global_work_offset */
-		global_work_size,		/* global_work_size */
-		local_work_size,		/* local_work_size, also referred to as the size of the work-group */
-		NULL,					/* num_events_in_wait_list */
-		NULL,					/* event_wait_list */
-		NULL					/* event */
-	);
-	SIMPLE_CHECK_ERRORS(err);
+	int status = enqueueKernelTiles(deviceInfo, kernel, "Kernel", device_buffer_output, iters, width, height, local_work_size, compact);
 
 	// -----------------------------------------------------------------------
 	// 15. Get results (output buffer) from global device memory
 
-	err = clEnqueueReadBuffer(
-		deviceInfo.cmd_queue,	/* command_queue */
-		device_buffer_output,	/* buffer */
-		CL_TRUE,				/* blocking_read */
-		0,						/* offset */
-		sizeof(int) * size,		/* size */
-		iters,					/* ptr */
-		NULL,					/* num_events_in_wait_list */
-		NULL,					/* event_wait_list */
-		NULL					/* event */
-	);
+	if (status == CL_SUCCESS) {
+		// -----------------------------------------------------------------------
+		// 16. Collect profiling timestamps of the enqueued commands, readIterations records the read
+
+		readIterations(deviceInfo, device_buffer_output, iters, size, compact, "Read output");
 
+		if (distances != NULL) {
+			cl_event read_event;
+			unsigned long long readEnqueueNs = hostTimeNs();
+			err = clEnqueueReadBuffer(deviceInfo.cmd_queue, device_buffer_distances, CL_TRUE, 0, sizeof(float) * size, distances, 0, NULL, &read_event);
+			SIMPLE_CHECK_ERRORS(err);
+			recordEvent(read_event, "Read distances", PROFILE_TRANSFER, readEnqueueNs);
+		}
+	}
 
 	// -----------------------------------------------------------------------
 	// 17. Free alocated resources
-	free(deviceInfo.devices);
+	// The device setup and program stay cached for the next render
+	clReleaseKernel(kernel);
+	clReleaseMemObject(device_buffer_input);
+	clReleaseMemObject(device_buffer_output);
+	if (device_buffer_distances != NULL) {
+		clReleaseMemObject(device_buffer_distances);
+	}
 
-	return CL_SUCCESS;
+	return status;
+}
+
+int calculateIters(Complex* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter) {
+	return calculateItersWithKernel("kernel.cl", points, sizeof(Complex), iters, width, height, max_iter, NULL, 0, kernelFormulaOptions);
+}
+
+int calculateItersFloat(ComplexFloat* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter) {
+	return calculateItersWithKernel("kernelFloat.cl", points, sizeof(ComplexFloat), iters, width, height, max_iter, NULL, 0, kernelFormulaOptions);
+}
+
+int calculateItersDoubleDouble(ComplexDD* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter) {
+	return calculateItersWithKernel("kernelDD.cl", points, sizeof(ComplexDD), iters, width, height, max_iter);
 }
 
-int calculateItersHighPrecision(ComplexHP* points, int* iters, unsigned int size, unsigned int max_iter) {
-	OpenclDeviceSetupInfo deviceInfo = setupOpenclDevices();
+int calculateDistances(Complex* points, int* iters, float* distances, unsigned int width, unsigned int height, unsigned int max_iter,
+	double pixelSize) {
+	return calculateItersWithKernel("kernel.cl", points, sizeof(Complex), iters, width, height, max_iter, distances, pixelSize);
+}
+
+int calculateItersChunked(Complex* points, int* iters, unsigned int size, unsigned int max_iter, unsigned int chunk,
+	vector<unsigned int>& activeCounts) {
+	unsigned long long setupStartNs = hostTimeNs();
+	OpenclDeviceSetupInfo deviceInfo = acquireOpenclDevices();
+	recordHostPhase("Device setup", PROFILE_SETUP, setupStartNs);
+	cl_int err = deviceInfo.err;
+
+	// -----------------------------------------------------------------------
+	// 8. Create memory buffers, z is kept on the device between launches and the
+	// indices of unfinished pixels are ping-ponged between two buffers
+
+	cl_mem device_buffer_input = clCreateBuffer(deviceInfo.context, CL_MEM_READ_ONLY, sizeof(Complex) * size, NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_mem device_buffer_z = clCreateBuffer(deviceInfo.context, CL_MEM_READ_WRITE, sizeof(Complex) * size, NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_mem device_buffer_output = clCreateBuffer(deviceInfo.context, CL_MEM_WRITE_ONLY, sizeof(int) * size, NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_mem device_buffer_active[2];
+	for (int i = 0; i < 2; i++) {
+		device_buffer_active[i] = clCreateBuffer(deviceInfo.context, CL_MEM_READ_WRITE, sizeof(cl_uint) * size, NULL, &err);
+		SIMPLE_CHECK_ERRORS(err);
+	}
+	cl_mem device_buffer_active_count = clCreateBuffer(deviceInfo.context, CL_MEM_READ_WRITE, sizeof(cl_uint), NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+
+	// -----------------------------------------------------------------------
+	// 9. Tranfer data from the host memory to the device memory
+
+	cl_event write_event;
+	unsigned long long writeEnqueueNs = hostTimeNs();
+	err = clEnqueueWriteBuffer(deviceInfo.cmd_queue, device_buffer_input, CL_TRUE, 0, sizeof(Complex) * size, points, 0, NULL, &write_event);
+	SIMPLE_CHECK_ERRORS(err);
+	recordEvent(write_event, "Write input", PROFILE_TRANSFER, writeEnqueueNs);
+
+	// -----------------------------------------------------------------------
+	// 10. - 11. Create program and kernel
+
+	unsigned long long buildStartNs = hostTimeNs();
+	cl_kernel kernel = createKernelFromFile(deviceInfo, "kernelChunked.cl", "iterateChunk");
+	recordHostPhase("Program build", PROFILE_BUILD, buildStartNs);
+
+	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &device_buffer_input);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &device_buffer_z);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &device_buffer_output);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 5, sizeof(cl_mem), &device_buffer_active_count);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_uint chunk_kernel = chunk;
+	cl_uint max_iter_kernel = max_iter;
+	err = clSetKernelArg(kernel, 8, sizeof(cl_uint), &chunk_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 9, sizeof(cl_uint), &max_iter_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+
+	// The compacted index list is one-dimensional, the widest single-row candidate is used
+	size_t local_work_size[1] = { 0 };
+	for (const pair<size_t, size_t>& candidate : workGroupCandidates(deviceInfo, kernel)) {
+		if (candidate.second == 1) {
+			local_work_size[0] = max(local_work_size[0], candidate.first);
+		}
+	}
+	lastWorkGroupShape[0] = local_work_size[0];
+	lastWorkGroupShape[1] = 1;
+
+	// -----------------------------------------------------------------------
+	// 12. - 16. Launch chunks until every pixel has escaped or reached max_iter
+
+	activeCounts.clear();
+	int status = CL_SUCCESS;
+	cl_uint active_count = size;
+	int current = 0;
+	for (cl_uint first_iter = 0; active_count > 0 && (first_iter < max_iter || first_iter == 0); first_iter += chunk) {
+		activeCounts.push_back(active_count);
+
+		cl_uint zero = 0;
+		err = clEnqueueWriteBuffer(deviceInfo.cmd_queue, device_buffer_active_count, CL_FALSE, 0, sizeof(cl_uint), &zero, 0, NULL, NULL);
+		SIMPLE_CHECK_ERRORS(err);
+		err = clSetKernelArg(kernel, 3, sizeof(cl_mem), &device_buffer_active[current]);
+		SIMPLE_CHECK_ERRORS(err);
+		err = clSetKernelArg(kernel, 4, sizeof(cl_mem), &device_buffer_active[1 - current]);
+		SIMPLE_CHECK_ERRORS(err);
+		err = clSetKernelArg(kernel, 6, sizeof(cl_uint), &active_count);
+		SIMPLE_CHECK_ERRORS(err);
+		err = clSetKernelArg(kernel, 7, sizeof(cl_uint), &first_iter);
+		SIMPLE_CHECK_ERRORS(err);
+
+		size_t global_work_size[1] = { roundUp(active_count, local_work_size[0]) };
+		cl_event kernel_event;
+		unsigned long long kernelEnqueueNs = hostTimeNs();
+		err = clEnqueueNDRangeKernel(deviceInfo.cmd_queue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &kernel_event);
+		SIMPLE_CHECK_ERRORS(err);
+
+		// The blocking read of the counter also waits for the kernel
+		err = clEnqueueReadBuffer(deviceInfo.cmd_queue, device_buffer_active_count, CL_TRUE, 0, sizeof(cl_uint), &active_count, 0, NULL, NULL);
+		SIMPLE_CHECK_ERRORS(err);
+		recordEvent(kernel_event, "Kernel chunk", PROFILE_KERNEL, kernelEnqueueNs);
+		current = 1 - current;
+		if (renderCancelled()) {
+			status = CALCULATE_ITERS_CANCELLED;
+			break;
+		}
+	}
+
+	if (status == CL_SUCCESS) {
+		cl_event read_event;
+		unsigned long long readEnqueueNs = hostTimeNs();
+		err = clEnqueueReadBuffer(deviceInfo.cmd_queue, device_buffer_output, CL_TRUE, 0, sizeof(int) * size, iters, 0, NULL, &read_event);
+		SIMPLE_CHECK_ERRORS(err);
+		recordEvent(read_event, "Read output", PROFILE_TRANSFER, readEnqueueNs);
+	}
+
+	// -----------------------------------------------------------------------
+	// 17. Free alocated resources
+	// The device setup and program stay cached for the next render
+	clReleaseKernel(kernel);
+	clReleaseMemObject(device_buffer_input);
+	clReleaseMemObject(device_buffer_z);
+	clReleaseMemObject(device_buffer_output);
+	clReleaseMemObject(device_buffer_active[0]);
+	clReleaseMemObject(device_buffer_active[1]);
+	clReleaseMemObject(device_buffer_active_count);
+
+	return status;
+}
+
+int calculateItersPerturbation(Complex* referenceOrbit, unsigned int referenceLength, FloatExp deltaOrigin[2], FloatExp deltaStep[2],
+	int* iters, unsigned int width, unsigned int height, unsigned int max_iter) {
+	unsigned long long setupStartNs = hostTimeNs();
+	OpenclDeviceSetupInfo deviceInfo = acquireOpenclDevices();
+	recordHostPhase("Device setup", PROFILE_SETUP, setupStartNs);
 	cl_int err = deviceInfo.err;
+	unsigned int size = width * height;
+	bool compact = compactIters(max_iter);
 
 	// -----------------------------------------------------------------------
 	// 8. Create memory buffers
 
-	cl_mem device_buffer_input;
+	cl_mem device_buffer_reference;
 	cl_mem device_buffer_output;
 
-	device_buffer_input = clCreateBuffer(
-		deviceInfo.context,			/* context */
-		CL_MEM_READ_ONLY,			/* flags */
-		sizeof(ComplexHP) * size,	/* size */
-		NULL,						/* host_ptr */
-		&err						/* errcode_ret */
+	device_buffer_reference = clCreateBuffer(
+		deviceInfo.context,					/* context */
+		CL_MEM_READ_ONLY,					/* flags */
+		sizeof(Complex) * referenceLength,	/* size */
+		NULL,								/* host_ptr */
+		&err								/* errcode_ret */
 	);
 
 	SIMPLE_CHECK_ERRORS(err);
@@ -448,7 +1110,7 @@ int calculateItersHighPrecision(ComplexHP* points, int* iters, unsigned int size
 	device_buffer_output = clCreateBuffer(
 		deviceInfo.context,
 		CL_MEM_WRITE_ONLY,
-		sizeof(int) * size,
+		iterSize(compact) * size,
 		NULL,
 		&err
 	);
@@ -456,137 +1118,258 @@ int calculateItersHighPrecision(ComplexHP* points, int* iters, unsigned int size
 	SIMPLE_CHECK_ERRORS(err);
 
 	// -----------------------------------------------------------------------
-	// 9. Tranfer data from the host memory to the device memory
+	// 9. Tranfer the reference orbit to the device memory, pixels are derived from their index
 
-	// Transfer data from host_buffer_A to device_buffer_A
+	cl_event write_event;
+	unsigned long long writeEnqueueNs = hostTimeNs();
 	err = clEnqueueWriteBuffer(
-		deviceInfo.cmd_queue,		/* command_queue */
-		device_buffer_input,		/* buffer */
-		CL_TRUE,					/* blocking_write */
-		0,							/* offset */
-		sizeof(ComplexHP) * size,	/* size */
-		points,						/* ptr */
-		NULL,						/* num_events_in_wait_list */
-		NULL,						/* event_wait_list */
-		NULL						/* event */
+		deviceInfo.cmd_queue,				/* command_queue */
+		device_buffer_reference,			/* buffer */
+		CL_TRUE,							/* blocking_write */
+		0,									/* offset */
+		sizeof(Complex) * referenceLength,	/* size */
+		referenceOrbit,						/* ptr */
+		NULL,								/* num_events_in_wait_list */
+		NULL,								/* event_wait_list */
+		&write_event						/* event */
 	);
 
 	SIMPLE_CHECK_ERRORS(err);
+	recordEvent(write_event, "Write input", PROFILE_TRANSFER, writeEnqueueNs);
 
 	// -----------------------------------------------------------------------
-	// 10. Create and compile OpenCL program
+	// 10. - 11. Create program and kernel
 
-	ifstream kernelFileStream("kernelHP.cl");
-	std::string kernelSrcFileContent((std::istreambuf_iterator<char>(kernelFileStream)), std::istreambuf_iterator<char>());
-	const char* kernelSrc = kernelSrcFileContent.c_str();
+	unsigned long long buildStartNs = hostTimeNs();
+	string buildOptions = compact ? COMPACT_BUILD_OPTIONS : "";
+	cl_kernel kernel = createKernelFromFile(deviceInfo, "kernelPT.cl", "calculateIters", buildOptions.c_str());
+	recordHostPhase("Program build", PROFILE_BUILD, buildStartNs);
 
-	// Create Progam object
-	cl_program program = clCreateProgramWithSource(
-		deviceInfo.context,					/* context */
-		1,									/* count */
-		&kernelSrc,							/* strings */
-		NULL,								/* lengths */
-		&err								/* errcode_ret */
-	);
-	SIMPLE_CHECK_ERRORS(err);
+	// -----------------------------------------------------------------------
+	// 12. Set kernel function argument list
 
-	// Compile Program object
-	err = clBuildProgram(
-		program,			/* program */
-		1,					/* num_devices */
-		deviceInfo.devices,	/* device_list */
-		NULL,				/* options */
-		NULL,				/* pfn_notify */
-		NULL				/* user_data */
-	);
-	printError(program, deviceInfo.devices[0]);
+	cl_uint reference_length_kernel = referenceLength;
+	cl_uint max_iter_kernel = max_iter;
+	cl_uint width_kernel = width;
+	cl_uint height_kernel = height;
+	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &device_buffer_reference);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 1, sizeof(cl_uint), &reference_length_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &device_buffer_output);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 3, sizeof(cl_uint), &max_iter_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 4, sizeof(cl_uint), &width_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 5, sizeof(cl_uint), &height_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 6, sizeof(FloatExp), &deltaOrigin[0]);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 7, sizeof(FloatExp), &deltaOrigin[1]);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 8, sizeof(FloatExp), &deltaStep[0]);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 9, sizeof(FloatExp), &deltaStep[1]);
 	SIMPLE_CHECK_ERRORS(err);
 
 	// -----------------------------------------------------------------------
-	// 11. Create kernel
+	// 13. Define work-item and work-group
 
-	cl_kernel kernel = NULL;
-	kernel = clCreateKernel(
-		program,					/* program */
-		"calculateIters",			/* kernel_name - needs to match function name inside kernel */
-		&err						/* errcode_ret */
-	);
+	size_t local_work_size[2];
+	selectWorkGroupShape(deviceInfo, kernel, tuningLabel("kernelPT.cl", "calculateIters", buildOptions), width, height, max_iter, local_work_size);
+
+	// -----------------------------------------------------------------------
+	// 14. Enqueue (run) the kernel(s), one tile at a time
+
+	int status = enqueueKernelTiles(deviceInfo, kernel, "Kernel", device_buffer_output, iters, width, height, local_work_size, compact);
+
+	// -----------------------------------------------------------------------
+	// 15. Get results (output buffer) from global device memory
+
+	if (status == CL_SUCCESS) {
+		// -----------------------------------------------------------------------
+		// 16. Collect profiling timestamps of the enqueued commands, readIterations records the read
 
+		readIterations(deviceInfo, device_buffer_output, iters, size, compact, "Read output");
+	}
+
+	// -----------------------------------------------------------------------
+	// 17. Free alocated resources
+	// The device setup and program stay cached for the next render
+	clReleaseKernel(kernel);
+	clReleaseMemObject(device_buffer_reference);
+	clReleaseMemObject(device_buffer_output);
+
+	return status;
+}
+
+int calculateItersHighPrecision(const FixedPointAxis& realAxis, const FixedPointAxis& imagAxis, int* iters,
+	unsigned int width, unsigned int height, unsigned int max_iter) {
+	unsigned long long setupStartNs = hostTimeNs();
+	OpenclDeviceSetupInfo deviceInfo = acquireOpenclDevices();
+	recordHostPhase("Device setup", PROFILE_SETUP, setupStartNs);
+	cl_int err = deviceInfo.err;
+	unsigned int size = width * height;
+	bool compact = compactIters(max_iter);
+
+	// -----------------------------------------------------------------------
+	// 8. - 9. Create the output buffer, pixels are derived from the axes on the device so there is no input
+
+	cl_mem device_buffer_output = clCreateBuffer(deviceInfo.context, CL_MEM_WRITE_ONLY, iterSize(compact) * size, NULL, &err);
 	SIMPLE_CHECK_ERRORS(err);
+
+	// -----------------------------------------------------------------------
+	// 10. - 11. Create program and kernel
+
+	unsigned long long buildStartNs = hostTimeNs();
+	string buildOptions = compact ? COMPACT_BUILD_OPTIONS : "";
+	cl_kernel kernel = createKernelFromFile(deviceInfo, "kernelHP.cl", "calculateIters", buildOptions.c_str());
+	recordHostPhase("Program build", PROFILE_BUILD, buildStartNs);
+
 	// -----------------------------------------------------------------------
 	// 12. Set kernel function argument list
 
-	err = clSetKernelArg(
-		kernel,					/* kernel */
-		0,						/* arg_index */
-		sizeof(cl_mem),			/* arg_size */
-		&device_buffer_input	/* arg_value */
-	);
+	cl_uint max_iter_kernel = max_iter;
+	cl_uint width_kernel = width;
+	cl_uint height_kernel = height;
+	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &device_buffer_output);
 	SIMPLE_CHECK_ERRORS(err);
-
-	err = clSetKernelArg(
-		kernel,
-		1,
-		sizeof(cl_mem),
-		&device_buffer_output
-	);
+	err = clSetKernelArg(kernel, 1, sizeof(cl_uint), &max_iter_kernel);
 	SIMPLE_CHECK_ERRORS(err);
-
-	cl_int max_iter_kernel = max_iter;
-	err = clSetKernelArg(
-		kernel,
-		2,
-		sizeof(unsigned int),
-		&max_iter_kernel
-	);
+	err = clSetKernelArg(kernel, 2, sizeof(cl_uint), &width_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 3, sizeof(cl_uint), &height_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 4, sizeof(FixedPointAxis), &realAxis);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 5, sizeof(FixedPointAxis), &imagAxis);
 	SIMPLE_CHECK_ERRORS(err);
 
-	// -----------------------------------------------------------------------	
+	// -----------------------------------------------------------------------
 	// 13. Define work-item and work-group
 
-	//size_t n_dim = 3;
-	//size_t global_work_size[3] = {data_size, 1, 1};
-	//size_t local_work_size[3]= {64, 1, 1};
+	size_t local_work_size[2];
+	selectWorkGroupShape(deviceInfo, kernel, tuningLabel("kernelHP.cl", "calculateIters", buildOptions), width, height, max_iter, local_work_size);
 
-	size_t n_dim = 1;
-	size_t global_work_size[1] = { size };
-	size_t local_work_size[1] = { 100 };	// Maximum work size is 1024
+	// -----------------------------------------------------------------------
+	// 14. Enqueue (run) the kernel(s), one tile at a time
+
+	int status = enqueueKernelTiles(deviceInfo, kernel, "Kernel", device_buffer_output, iters, width, height, local_work_size, compact);
 
 	// -----------------------------------------------------------------------
-	// 14. Enqueue (run) the kernel(s)
+	// 15. - 16. Get results (output buffer) from global device memory, readIterations records the read
 
-	err = clEnqueueNDRangeKernel(
-		deviceInfo.cmd_queue,	/* command_queue */
-		kernel,					/* kernel */
-		n_dim,					/* work_dim */
-		NULL,					/* global_work_offset */
-		global_work_size,		/* global_work_size */
-		local_work_size,		/* local_work_size, also referred to as the size of the work-group */
-		NULL,					/* num_events_in_wait_list */
-		NULL,					/* event_wait_list */
-		NULL					/* event */
-	);
+	if (status == CL_SUCCESS) {
+		readIterations(deviceInfo, device_buffer_output, iters, size, compact, "Read output");
+	}
+
+	// -----------------------------------------------------------------------
+	// 17. Free alocated resources
+	// The device setup and program stay cached for the next render
+	clReleaseKernel(kernel);
+	clReleaseMemObject(device_buffer_output);
+
+	return status;
+}
+
+int calculateDistancesHighPrecision(const FixedPointAxis& realAxis, const FixedPointAxis& imagAxis, const int* pixels,
+	unsigned int imageWidth, int* iters, float* distances, unsigned int width, unsigned int height, unsigned int max_iter,
+	double pixelSize) {
+	unsigned long long setupStartNs = hostTimeNs();
+	OpenclDeviceSetupInfo deviceInfo = acquireOpenclDevices();
+	recordHostPhase("Device setup", PROFILE_SETUP, setupStartNs);
+	cl_int err = deviceInfo.err;
+	unsigned int size = width * height;
+	bool compact = compactIters(max_iter);
+
+	// -----------------------------------------------------------------------
+	// 8. Create memory buffers, the input holds only the pixel indices
+
+	cl_mem device_buffer_pixels = clCreateBuffer(deviceInfo.context, CL_MEM_READ_ONLY, sizeof(cl_int) * size, NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_mem device_buffer_output = clCreateBuffer(deviceInfo.context, CL_MEM_WRITE_ONLY, iterSize(compact) * size, NULL, &err);
+	SIMPLE_CHECK_ERRORS(err);
+	cl_mem device_buffer_distances = clCreateBuffer(deviceInfo.context, CL_MEM_WRITE_ONLY, sizeof(float) * size, NULL, &err);
 	SIMPLE_CHECK_ERRORS(err);
 
 	// -----------------------------------------------------------------------
-	// 15. Get results (output buffer) from global device memory
+	// 9. Tranfer data from the host memory to the device memory
 
-	err = clEnqueueReadBuffer(
-		deviceInfo.cmd_queue,	/* command_queue */
-		device_buffer_output,	/* buffer */
-		CL_TRUE,				/* blocking_read */
-		0,						/* offset */
-		sizeof(int) * size,		/* size */
-		iters,					/* ptr */
-		NULL,					/* num_events_in_wait_list */
-		NULL,					/* event_wait_list */
-		NULL					/* event */
-	);
+	cl_event write_event;
+	unsigned long long writeEnqueueNs = hostTimeNs();
+	err = clEnqueueWriteBuffer(deviceInfo.cmd_queue, device_buffer_pixels, CL_TRUE, 0, sizeof(cl_int) * size, pixels, 0, NULL, &write_event);
+	SIMPLE_CHECK_ERRORS(err);
+	recordEvent(write_event, "Write pixels", PROFILE_TRANSFER, writeEnqueueNs);
+
+	// -----------------------------------------------------------------------
+	// 10. - 11. Create program and kernel
+
+	unsigned long long buildStartNs = hostTimeNs();
+	string buildOptions = compact ? COMPACT_BUILD_OPTIONS : "";
+	cl_kernel kernel = createKernelFromFile(deviceInfo, "kernelHP.cl", "calculateDistances", buildOptions.c_str());
+	recordHostPhase("Program build", PROFILE_BUILD, buildStartNs);
+
+	// -----------------------------------------------------------------------
+	// 12. Set kernel function argument list
 
+	cl_uint max_iter_kernel = max_iter;
+	cl_uint width_kernel = width;
+	cl_uint height_kernel = height;
+	cl_double pixel_size_kernel = pixelSize;
+	cl_uint image_width_kernel = imageWidth;
+	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &device_buffer_pixels);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &device_buffer_output);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 2, sizeof(cl_uint), &max_iter_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 3, sizeof(cl_uint), &width_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 4, sizeof(cl_uint), &height_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 5, sizeof(cl_mem), &device_buffer_distances);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 6, sizeof(cl_double), &pixel_size_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 7, sizeof(cl_uint), &image_width_kernel);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 8, sizeof(FixedPointAxis), &realAxis);
+	SIMPLE_CHECK_ERRORS(err);
+	err = clSetKernelArg(kernel, 9, sizeof(FixedPointAxis), &imagAxis);
+	SIMPLE_CHECK_ERRORS(err);
+
+	// -----------------------------------------------------------------------
+	// 13. Define work-item and work-group
+
+	size_t local_work_size[2];
+	selectWorkGroupShape(deviceInfo, kernel, tuningLabel("kernelHP.cl", "calculateDistances", buildOptions), width, height, max_iter, local_work_size);
+
+	// -----------------------------------------------------------------------
+	// 14. Enqueue (run) the kernel(s), one tile at a time
+
+	int status = enqueueKernelTiles(deviceInfo, kernel, "Kernel", device_buffer_output, iters, width, height, local_work_size, compact);
+
+	// -----------------------------------------------------------------------
+	// 15. - 16. Get results (output buffers) from global device memory, readIterations records the read
+
+	if (status == CL_SUCCESS) {
+		readIterations(deviceInfo, device_buffer_output, iters, size, compact, "Read output");
+
+		cl_event read_event;
+		unsigned long long readEnqueueNs = hostTimeNs();
+		err = clEnqueueReadBuffer(deviceInfo.cmd_queue, device_buffer_distances, CL_TRUE, 0, sizeof(float) * size, distances, 0, NULL, &read_event);
+		SIMPLE_CHECK_ERRORS(err);
+		recordEvent(read_event, "Read distances", PROFILE_TRANSFER, readEnqueueNs);
+	}
 
 	// -----------------------------------------------------------------------
 	// 17. Free alocated resources
-	free(deviceInfo.devices);
+	// The device setup and program stay cached for the next render
+	clReleaseKernel(kernel);
+	clReleaseMemObject(device_buffer_pixels);
+	clReleaseMemObject(device_buffer_output);
+	clReleaseMemObject(device_buffer_distances);
 
-	return CL_SUCCESS;
+	return status;
 }
\ No newline at end of file
@@ -3,16 +3,107 @@
 #ifndef CALCULATE_ITERS_H
 #define CALCULATE_ITERS_H
 
+#include <string>
+#include <vector>
+
+#include "FloatExp.h"
+
+#define UTILIZE_OPENCL_CPU 0
+#define UTILIZE_OPENCL_GPU 1
+#define UTILIZE_OPENCL_ACC 2
+
 struct Complex {
     double real;
     double imag;
 };
 
-struct ComplexHP {
-    unsigned int real[4]; // 4 bytes for whole part and 12 bytes for fraction part, using big endian
-    unsigned int imag[4];
+struct ComplexFloat {
+    float real;
+    float imag;
+};
+
+struct ComplexDD {
+    double real[2]; // double-double, high part first
+    double imag[2];
+};
+
+// Fixed point numbers are 4 big endian limbs, 4 bytes for the whole part and 12 bytes for the fraction part.
+// Fixed point coordinate of column or row k: start + k * step, start - k * step when descending.
+// stepLow holds the bits of the step below the last limb as a fraction, its carries are added to the offset.
+struct FixedPointAxis {
+    unsigned int start[4];
+    unsigned int step[4];
+    unsigned int stepLow[4];
+    int descending;
 };
 
-int calculateIters(Complex* points, int* iters, unsigned int size, unsigned int max_iter);
-int calculateItersHighPrecision(ComplexHP* points, int* iters, unsigned int size, unsigned int max_iter);
+#define PROFILE_SETUP 0
+#define PROFILE_BUILD 1
+#define PROFILE_TRANSFER 2
+#define PROFILE_KERNEL 3
+
+// Timestamps in nanoseconds on the host steady clock. Host phases have queued == submit == start.
+struct ProfilingRecord {
+    std::string name;
+    int category; // one of PROFILE_*
+    bool device;
+    unsigned long long queuedNs;
+    unsigned long long submitNs;
+    unsigned long long startNs;
+    unsigned long long endNs;
+};
+
+// Platform is matched by substring of its name, device type is one of UTILIZE_OPENCL_*
+void setOpenclTarget(const std::string& platformSubname, unsigned int deviceType);
+std::string getOpenclDeviceName();
+// The context, queue and programs are created on first use and kept until the target changes or this is called
+void releaseOpenclEngine();
+// Work-group width and height used by the last launch of an iteration kernel
+void getWorkGroupShape(unsigned int shape[2]);
+
+// Returned by the calculateIters* functions when the cancellation check fired, iters is left incomplete
+#define CALCULATE_ITERS_CANCELLED 1
+
+// Marks pixels of a partial result whose tile has not been computed yet
+#define ITERS_NOT_COMPUTED -2
+
+// Polled between kernel launches, returning true abandons the render in progress
+void setCancellationCheck(bool (*check)());
+// Called with the whole iteration buffer while a render runs, once the tiles nearest to the focus are done
+void setProgressCallback(void (*callback)(const int* iters, unsigned int width, unsigned int height));
+// Tiles are rendered in order of distance from this point, given as fractions of the image width and height
+void setRenderFocus(float x, float y);
+// Build options specializing the escape-time formula of calculateIters and calculateItersFloat, see formulaBuildOptions.
+// The other kernels only iterate the Mandelbrot set.
+void setKernelFormula(const std::string& buildOptions);
+
+int calculateIters(Complex* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter);
+// Iterates in launches of chunk iterations, each launch only covers the pixels that have not finished yet.
+// activeCounts receives the number of pixels every launch started with.
+int calculateItersChunked(Complex* points, int* iters, unsigned int size, unsigned int max_iter, unsigned int chunk,
+    std::vector<unsigned int>& activeCounts);
+// Single precision kernel, specialized by setKernelFormula like calculateIters
+int calculateItersFloat(ComplexFloat* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter);
+int calculateItersDoubleDouble(ComplexDD* points, int* iters, unsigned int width, unsigned int height, unsigned int max_iter);
+// Derives every pixel from the axes on the device, the only per-pixel memory is the output
+int calculateItersHighPrecision(const FixedPointAxis& realAxis, const FixedPointAxis& imagAxis, int* iters,
+    unsigned int width, unsigned int height, unsigned int max_iter);
+// Escape iterations with a larger escape radius plus the exterior distance estimate 2|z|ln|z|/|dz/dc| in pixels,
+// 0 for points that did not escape
+int calculateDistances(Complex* points, int* iters, float* distances, unsigned int width, unsigned int height, unsigned int max_iter,
+    double pixelSize);
+// Renders the pixels listed by their index in an image of imageWidth columns, laid out as width x height.
+// Like calculateItersHighPrecision the coordinates are derived from the axes on the device.
+int calculateDistancesHighPrecision(const FixedPointAxis& realAxis, const FixedPointAxis& imagAxis, const int* pixels,
+    unsigned int imageWidth, int* iters, float* distances, unsigned int width, unsigned int height, unsigned int max_iter,
+    double pixelSize);
+// Pixels are given as deltas from the reference orbit, delta = deltaOrigin + (column, row) * deltaStep
+int calculateItersPerturbation(Complex* referenceOrbit, unsigned int referenceLength, FloatExp deltaOrigin[2], FloatExp deltaStep[2],
+    int* iters, unsigned int width, unsigned int height, unsigned int max_iter);
+
+// Every calculateIters* call appends records for device setup, program build, transfers and the kernel
+size_t getProfilingRecordCount();
+const ProfilingRecord& getProfilingRecord(size_t index);
+void printProfilingRecords(size_t first);
+bool writeChromeTrace(const std::string& fileName);
 #endif
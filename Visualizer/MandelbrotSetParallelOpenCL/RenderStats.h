@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Phase timings of a single render, in milliseconds
+struct RenderStats {
+    double mappingMs = 0;
+    double iterationMs = 0;
+    double coloringMs = 0;
+    double imageMs = 0;
+    double totalMs = 0;
+    // Device profile of the iteration phase, from OpenCL event timestamps
+    double setupMs = 0;
+    double buildMs = 0;
+    double transferMs = 0;
+    double kernelMs = 0;
+    // Frame arena blocks obtained and first touched during the render, 0 once the arena is warm
+    double allocationMs = 0;
+    unsigned long long totalIterations = 0;
+    int pixels = 0;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include <SharedFrameBuffer.h>
+
+#include <atomic>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+using namespace boost::interprocess;
+
+// Layout is little endian, as are all targets the renderer runs on
+template <typename T>
+T readValue(const char* base, size_t offset) {
+    T value;
+    memcpy(&value, base + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void writeValue(char* base, size_t offset, T value) {
+    memcpy(base + offset, &value, sizeof(T));
+}
+
+size_t sharedFrameFileSize(unsigned int slotSize) {
+    return SHARED_FRAME_HEADER_SIZE * (1 + SHARED_FRAME_SLOTS) + (size_t)slotSize * SHARED_FRAME_SLOTS;
+}
+
+// Returns the slot size of an existing compatible file, 0 when it has to be (re)created.
+// The latest frame id is returned either way, so ids keep increasing when the file is recreated.
+unsigned int existingSlotSize(const string& fileName, unsigned long long& latestFrameId) {
+    ifstream in(fileName, ios::binary);
+    char header[24];
+    latestFrameId = 0;
+    if (!in.read(header, sizeof(header)) || memcmp(header, SHARED_FRAME_MAGIC, 4) != 0) {
+        return 0;
+    }
+    latestFrameId = readValue<unsigned long long>(header, 16);
+    if (readValue<unsigned int>(header, 4) != SHARED_FRAME_VERSION || readValue<unsigned int>(header, 8) != SHARED_FRAME_SLOTS) {
+        return 0;
+    }
+    return readValue<unsigned int>(header, 12);
+}
+
+bool replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// The file is built under another name and renamed over the old one, so a reader
+// that still maps the old file never sees it truncated
+bool createSharedFrameFile(const string& fileName, unsigned int slotSize, unsigned long long latestFrameId) {
+    string newFileName = fileName + ".new";
+    filebuf buffer;
+    if (!buffer.open(newFileName, ios::out | ios::trunc | ios::binary)) {
+        cerr << "Could not create " << newFileName << endl;
+        return false;
+    }
+    buffer.pubseekoff(sharedFrameFileSize(slotSize) - 1, ios::beg);
+    buffer.sputc(0);
+    buffer.pubseekoff(0, ios::beg);
+    char header[SHARED_FRAME_HEADER_SIZE] = {};
+    memcpy(header, SHARED_FRAME_MAGIC, 4);
+    writeValue<unsigned int>(header, 4, SHARED_FRAME_VERSION);
+    writeValue<unsigned int>(header, 8, SHARED_FRAME_SLOTS);
+    writeValue<unsigned int>(header, 12, slotSize);
+    writeValue<unsigned long long>(header, 16, latestFrameId);
+    bool written = buffer.sputn(header, sizeof(header)) == sizeof(header);
+    if (buffer.close() == nullptr || !written || !replaceFile(newFileName, fileName)) {
+        cerr << "Could not replace " << fileName << endl;
+        remove(newFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+unsigned long long publishSharedFrame(const string& fileName, const cv::Mat& image, const double viewport[4]) {
+    unsigned int stride = image.cols * 4;
+    unsigned int frameSize = stride * image.rows;
+    try {
+        // A renderer that is still finishing and the one started after it may publish at the same time,
+        // both would take the same frame id and slot
+        string lockFileName = fileName + ".lock";
+        ofstream(lockFileName, ios::app);
+        file_lock writerLock(lockFileName.c_str());
+        scoped_lock<file_lock> writerGuard(writerLock);
+
+        unsigned long long latestFrameId;
+        if (existingSlotSize(fileName, latestFrameId) < frameSize && !createSharedFrameFile(fileName, frameSize, latestFrameId)) {
+            return 0;
+        }
+
+        file_mapping mapping(fileName.c_str(), read_write);
+        mapped_region region(mapping, read_write);
+        char* base = static_cast<char*>(region.get_address());
+        // The slot size is taken from the mapped file, which may differ from the one read above
+        unsigned int slotSize = region.get_size() >= SHARED_FRAME_HEADER_SIZE ? readValue<unsigned int>(base, 12) : 0;
+        if (slotSize < frameSize || region.get_size() < sharedFrameFileSize(slotSize)) {
+            cerr << fileName << " is too small for a " << image.cols << "x" << image.rows << " frame" << endl;
+            return 0;
+        }
+
+        unsigned long long frameId = readValue<unsigned long long>(base, 16) + 1;
+        unsigned int slot = (unsigned int)((frameId - 1) % SHARED_FRAME_SLOTS);
+        char* slotHeader = base + SHARED_FRAME_HEADER_SIZE * (1 + slot);
+        unsigned char* slotData = (unsigned char*)base + SHARED_FRAME_HEADER_SIZE * (1 + SHARED_FRAME_SLOTS) + (size_t)slotSize * slot;
+
+        // Readers reject the slot while its id is 0
+        writeValue<unsigned long long>(slotHeader, 0, 0);
+        atomic_thread_fence(memory_order_release);
+
+        writeValue<unsigned int>(slotHeader, 8, image.cols);
+        writeValue<unsigned int>(slotHeader, 12, image.rows);
+        writeValue<unsigned int>(slotHeader, 16, stride);
+        for (int i = 0; i < 4; i++) {
+            writeValue<double>(slotHeader, 24 + 8 * i, viewport[i]);
+        }
+        #pragma omp parallel for
+        for (int y = 0; y < image.rows; y++) {
+            const unsigned char* in = image.data + y * image.step;
+            unsigned char* out = slotData + (size_t)y * stride;
+            for (int x = 0; x < image.cols; x++) {
+                out[4 * x] = in[3 * x + 2];
+                out[4 * x + 1] = in[3 * x + 1];
+                out[4 * x + 2] = in[3 * x];
+                out[4 * x + 3] = 255;
+            }
+        }
+
+        atomic_thread_fence(memory_order_release);
+        writeValue<unsigned long long>(slotHeader, 0, frameId);
+        atomic_thread_fence(memory_order_release);
+        writeValue<unsigned long long>(base, 16, frameId);
+        return frameId;
+    }
+    catch (const interprocess_exception& e) {
+        cerr << "Could not map " << fileName << ": " << e.what() << endl;
+        return 0;
+    }
+}
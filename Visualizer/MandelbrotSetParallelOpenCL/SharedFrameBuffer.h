@@ -0,0 +1,29 @@
+#pragma once
+
+#ifndef SHARED_FRAME_BUFFER_H
+#define SHARED_FRAME_BUFFER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+using namespace std;
+
+// Memory-mapped ring of frames shared with the GUI, all values little endian:
+//
+// file header (64 bytes)   0 magic "MBFB", 4 version, 8 slot count, 12 slot size in bytes (u32),
+//                          16 id of the latest complete frame (u64, 0 = none)
+// slot headers (64 bytes)  0 frame id (u64, 0 while the slot is being written), 8 width, 12 height,
+//                          16 stride in bytes (u32), 24 re start, 32 re end, 40 im start, 48 im end (f64)
+// slot data                RGBA rows, top row first, ready for a canvas ImageData
+//
+// Frame n goes to slot (n - 1) % slot count. A reader takes the latest frame id, copies its slot and
+// accepts the copy only if the slot still holds that id afterwards.
+const char SHARED_FRAME_MAGIC[4] = { 'M', 'B', 'F', 'B' };
+const unsigned int SHARED_FRAME_VERSION = 1;
+const unsigned int SHARED_FRAME_SLOTS = 3;
+const unsigned int SHARED_FRAME_HEADER_SIZE = 64;
+
+// Viewport is { reStart, reEnd, imStart, imEnd }. The file is created, or replaced by a larger one when the frame
+// does not fit its slots. Writers are serialised by a lock on fileName.lock. Returns the id of the published frame, 0 on failure.
+unsigned long long publishSharedFrame(const string& fileName, const cv::Mat& image, const double viewport[4]);
+#endif
@@ -0,0 +1,212 @@
+#include <ThreadPlacement.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <omp.h>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+struct NodeCounters {
+    double itemsPerMs = 0;  // summed over the node's threads, which run at the same time
+    int threads = 0;
+};
+
+struct PhaseCounters {
+    map<int, NodeCounters> nodes;
+    int calls = 0;
+};
+
+map<string, PhaseCounters> nodeThroughput;
+mutex nodeThroughputMutex;
+
+#ifndef _WIN32
+// Parses a sysfs CPU list such as "0-15,32-47"
+vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream ranges(list);
+    string range;
+    while (getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        int first = stoi(range.substr(0, dash));
+        int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+#endif
+
+vector<vector<int>> readNumaNodeCpus() {
+    vector<vector<int>> nodes;
+#ifdef _WIN32
+    // Processor group 0 only, which holds up to 64 logical CPUs
+    ULONG highestNode = 0;
+    GetNumaHighestNodeNumber(&highestNode);
+    for (USHORT node = 0; node <= highestNode; node++) {
+        GROUP_AFFINITY affinity;
+        if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Group != 0) {
+            continue;
+        }
+        vector<int> cpus;
+        for (int cpu = 0; cpu < 64; cpu++) {
+            if (affinity.Mask & (1ull << cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+#else
+    for (int node = 0;; node++) {
+        ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        string list;
+        if (!getline(in, list)) {
+            break;
+        }
+        vector<int> cpus = parseCpuList(list);
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        vector<int> cpus;
+        for (int cpu = 0; cpu < omp_get_num_procs(); cpu++) {
+            cpus.push_back(cpu);
+        }
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+const vector<vector<int>>& numaNodeCpus() {
+    static vector<vector<int>> nodes = readNumaNodeCpus();
+    return nodes;
+}
+
+int nodeOfCpu(int cpu) {
+    const vector<vector<int>>& nodes = numaNodeCpus();
+    for (size_t node = 0; node < nodes.size(); node++) {
+        for (int nodeCpu : nodes[node]) {
+            if (nodeCpu == cpu) {
+                return node;
+            }
+        }
+    }
+    return 0;
+}
+
+int currentCpu() {
+#ifdef _WIN32
+    return GetCurrentProcessorNumber();
+#else
+    return sched_getcpu();
+#endif
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), 1ull << cpu) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+bool pinOpenmpThreads(const string& policy) {
+    if (policy == "none") {
+        return true;
+    }
+    const vector<vector<int>>& nodes = numaNodeCpus();
+    vector<int> order;
+    if (policy == "close") {
+        for (const vector<int>& cpus : nodes) {
+            order.insert(order.end(), cpus.begin(), cpus.end());
+        }
+    }
+    else if (policy == "spread") {
+        for (size_t k = 0; order.size() < (size_t)omp_get_num_procs() && k < (size_t)omp_get_num_procs(); k++) {
+            for (const vector<int>& cpus : nodes) {
+                if (k < cpus.size()) {
+                    order.push_back(cpus[k]);
+                }
+            }
+        }
+    }
+    else {
+        return false;
+    }
+
+    // OpenMP keeps its worker threads, so the affinity set here holds for every later parallel region
+    int failed = 0;
+    #pragma omp parallel reduction(+:failed)
+    {
+        failed += !pinCurrentThread(order[omp_get_thread_num() % order.size()]);
+    }
+    if (failed > 0) {
+        cerr << "Could not pin " << failed << " OpenMP threads" << endl;
+    }
+    cout << "Pinned " << omp_get_max_threads() << " OpenMP threads " << policy << " over " << nodes.size() << " NUMA nodes" << endl;
+    return true;
+}
+
+void parallelStatic(long long count, const function<void(long long begin, long long end)>& body) {
+    #pragma omp parallel
+    {
+        long long threads = omp_get_num_threads();
+        long long thread = omp_get_thread_num();
+        // The first count % threads threads take one item more, as the static schedule does
+        long long chunk = count / threads;
+        long long extra = count % threads;
+        long long begin = thread * chunk + min(thread, extra);
+        long long end = begin + chunk + (thread < extra ? 1 : 0);
+        if (begin < end) {
+            body(begin, end);
+        }
+    }
+}
+
+void parallelStaticTimed(const string& phase, long long count, const function<void(long long begin, long long end)>& body) {
+    {
+        lock_guard<mutex> lock(nodeThroughputMutex);
+        nodeThroughput[phase].calls++;
+    }
+    parallelStatic(count, [&](long long begin, long long end) {
+        auto start = chrono::high_resolution_clock::now();
+        body(begin, end);
+        double busyMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        int node = nodeOfCpu(currentCpu());
+        lock_guard<mutex> lock(nodeThroughputMutex);
+        NodeCounters& counters = nodeThroughput[phase].nodes[node];
+        counters.itemsPerMs += busyMs > 0 ? (end - begin) / busyMs : 0;
+        counters.threads++;
+    });
+}
+
+void printNodeThroughput() {
+    lock_guard<mutex> lock(nodeThroughputMutex);
+    for (const auto& phase : nodeThroughput) {
+        cout << phase.first << " per NUMA node:";
+        int calls = phase.second.calls;
+        for (const auto& node : phase.second.nodes) {
+            double rate = node.second.itemsPerMs / calls / 1000.0;
+            cout << "  node " << node.first << ": " << rate << " M items/s over " << node.second.threads / calls << " threads";
+        }
+        cout << endl;
+    }
+    nodeThroughput.clear();
+}
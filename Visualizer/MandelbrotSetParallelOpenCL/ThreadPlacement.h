@@ -0,0 +1,26 @@
+#pragma once
+
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Logical CPUs of every NUMA node, a single node with all CPUs when the system reports none
+const vector<vector<int>>& numaNodeCpus();
+// Pins every OpenMP thread to one logical CPU, like OMP_PLACES=cores with OMP_PROC_BIND. "close" fills one node
+// before the next, so neighbouring static chunks share a socket, "spread" deals the threads round-robin over
+// the nodes and "none" leaves placement to the system. Returns false for an unknown policy.
+bool pinOpenmpThreads(const string& policy);
+
+// Splits [0, count) into the contiguous per-thread ranges of "omp parallel for schedule(static)". Buffers first
+// touched through it end up on the node of the thread that processes the same range later.
+void parallelStatic(long long count, const function<void(long long begin, long long end)>& body);
+// parallelStatic that also adds the items and busy time of every thread to its node under the phase name
+void parallelStaticTimed(const string& phase, long long count, const function<void(long long begin, long long end)>& body);
+// Items per second of every node in each timed phase, then clears the counters
+void printNodeThroughput();
+#endif
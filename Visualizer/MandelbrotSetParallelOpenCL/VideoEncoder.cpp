@@ -0,0 +1,108 @@
+#include <VideoEncoder.h>
+
+#include <iostream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_WRITE_MODE "wb"
+#else
+#define PIPE_WRITE_MODE "w"
+#endif
+
+// Codec from the file extension, MJPG in an .avi container otherwise
+int fourccForFile(const string& fileName) {
+    size_t dot = fileName.find_last_of('.');
+    string extension = dot == string::npos ? "" : fileName.substr(dot + 1);
+    if (extension == "mp4" || extension == "m4v") {
+        return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    }
+    return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+}
+
+VideoEncoder::VideoEncoder(const string& target, int width, int height, double fps, size_t queueCapacity) {
+    this->queueCapacity = queueCapacity;
+    if (!target.empty() && target[0] == '|') {
+        this->pipe = popen(target.substr(1).c_str(), PIPE_WRITE_MODE);
+        this->opened = this->pipe != nullptr;
+    }
+    else {
+        this->opened = this->writer.open(target, fourccForFile(target), fps, cv::Size(width, height), true);
+    }
+    if (!this->opened) {
+        cerr << "Could not open video output " << target << endl;
+        return;
+    }
+    this->worker = thread(&VideoEncoder::run, this);
+}
+
+VideoEncoder::~VideoEncoder() {
+    finish();
+}
+
+bool VideoEncoder::isOpened() const {
+    return this->opened;
+}
+
+int VideoEncoder::getEncodedFrames() const {
+    return this->encodedFrames;
+}
+
+void VideoEncoder::push(const cv::Mat& frame) {
+    if (!this->opened) {
+        return;
+    }
+    unique_lock<mutex> lock(this->queueMutex);
+    this->queueChanged.wait(lock, [this] { return this->queue.size() < this->queueCapacity; });
+    this->queue.push_back(frame);
+    this->queueChanged.notify_all();
+}
+
+void VideoEncoder::finish() {
+    if (!this->worker.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        this->finishing = true;
+    }
+    this->queueChanged.notify_all();
+    this->worker.join();
+    if (this->pipe != nullptr) {
+        pclose(this->pipe);
+        this->pipe = nullptr;
+    }
+    else {
+        this->writer.release();
+    }
+}
+
+void VideoEncoder::run() {
+    while (true) {
+        cv::Mat frame;
+        {
+            unique_lock<mutex> lock(this->queueMutex);
+            this->queueChanged.wait(lock, [this] { return !this->queue.empty() || this->finishing; });
+            if (this->queue.empty()) {
+                return;
+            }
+            frame = this->queue.front();
+            this->queue.pop_front();
+        }
+        this->queueChanged.notify_all();
+        encode(frame);
+    }
+}
+
+void VideoEncoder::encode(const cv::Mat& frame) {
+    if (this->pipe != nullptr) {
+        // Raw frames are written row by row, the matrix may be padded or a view into a larger image
+        for (int y = 0; y < frame.rows; y++) {
+            fwrite(frame.data + y * frame.step, 3, frame.cols, this->pipe);
+        }
+    }
+    else {
+        this->writer.write(frame);
+    }
+    this->encodedFrames++;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// Encodes BGR frames on a worker thread, so rendering of the next frame overlaps with encoding.
+// Frames wait in a bounded queue, push blocks while it is full to keep memory use fixed.
+class VideoEncoder {
+public:
+    // A target starting with '|' is a command that receives raw bgr24 frames of width x height on
+    // its standard input (e.g. "|ffmpeg -f rawvideo -pix_fmt bgr24 -s 900x600 -r 30 -i - zoom.mp4"),
+    // anything else is a video file written by cv::VideoWriter
+    VideoEncoder(const string& target, int width, int height, double fps, size_t queueCapacity);
+    ~VideoEncoder();
+    bool isOpened() const;
+    void push(const cv::Mat& frame);
+    // Waits until every queued frame is encoded and closes the output
+    void finish();
+    int getEncodedFrames() const;
+private:
+    void run();
+    void encode(const cv::Mat& frame);
+
+    cv::VideoWriter writer;
+    FILE* pipe = nullptr;
+    size_t queueCapacity;
+    deque<cv::Mat> queue;
+    mutex queueMutex;
+    condition_variable queueChanged;
+    bool finishing = false;
+    bool opened = false;
+    int encodedFrames = 0;
+    thread worker;
+};
+#endif
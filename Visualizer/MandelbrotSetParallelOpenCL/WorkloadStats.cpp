@@ -0,0 +1,130 @@
+#include <WorkloadStats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "ImageWriter.h"
+
+int pixelCost(int iter, int maxIter) {
+    return iter == -1 ? maxIter : iter + 1;
+}
+
+// Work-groups cover tileWidth x tileHeight pixels and number their work-items row by row,
+// lockstep groups are runs of `lanes` consecutive work-items inside a work-group
+DivergenceStats computeDivergence(const int* iters, int width, int height, int maxIter, int tileWidth, int tileHeight, int lanes) {
+    int tilesX = (width + tileWidth - 1) / tileWidth;
+    int tilesY = (height + tileHeight - 1) / tileHeight;
+    double efficiencySum = 0;
+    double executed = 0;
+    double useful = 0;
+    int groupCount = 0;
+    int interiorGroups = 0;
+    #pragma omp parallel for reduction(+:efficiencySum, executed, useful, groupCount, interiorGroups)
+    for (int tile = 0; tile < tilesX * tilesY; tile++) {
+        int tileX = tile % tilesX * tileWidth;
+        int tileY = tile / tilesX * tileHeight;
+        for (int first = 0; first < tileWidth * tileHeight; first += lanes) {
+            long long sum = 0;
+            int slowest = 0;
+            int count = 0;
+            bool interior = true;
+            for (int lane = first; lane < min(first + lanes, tileWidth * tileHeight); lane++) {
+                int x = tileX + lane % tileWidth;
+                int y = tileY + lane / tileWidth;
+                // Padding work-items return immediately
+                if (x >= width || y >= height) {
+                    continue;
+                }
+                int iter = iters[y * width + x];
+                int cost = pixelCost(iter, maxIter);
+                sum += cost;
+                slowest = max(slowest, cost);
+                count++;
+                interior = interior && iter == -1;
+            }
+            if (count == 0) {
+                continue;
+            }
+            efficiencySum += (double)sum / ((double)slowest * count);
+            executed += (double)slowest * count;
+            useful += sum;
+            groupCount++;
+            interiorGroups += interior ? 1 : 0;
+        }
+    }
+    return {
+        lanes,
+        efficiencySum / groupCount,
+        executed > 0 ? (executed - useful) / executed : 0,
+        (double)interiorGroups / groupCount
+    };
+}
+
+WorkloadStats computeWorkloadStats(const int* iters, int width, int height, int maxIter, int groupWidth, int groupHeight) {
+    int size = width * height;
+    WorkloadStats stats;
+    stats.totalIterations = 0;
+    stats.interiorCount = 0;
+    stats.histogram.assign((int)ceil(log2((double)maxIter)) + 2, 0);
+    for (int i = 0; i < size; i++) {
+        stats.totalIterations += pixelCost(iters[i], maxIter);
+        if (iters[i] == -1) {
+            stats.interiorCount++;
+        }
+        else {
+            int bucket = iters[i] == 0 ? 0 : (int)log2((double)iters[i]) + 1;
+            stats.histogram[min(bucket, (int)stats.histogram.size() - 1)]++;
+        }
+    }
+    stats.interiorFraction = (double)stats.interiorCount / size;
+    stats.simd = computeDivergence(iters, width, height, maxIter, groupWidth, groupHeight, SIMD_WIDTH);
+    stats.workGroup = computeDivergence(iters, width, height, maxIter, groupWidth, groupHeight, groupWidth * groupHeight);
+    return stats;
+}
+
+void printDivergence(const char* name, const DivergenceStats& divergence) {
+    cout << "    " << name << " of " << divergence.groupSize << ": efficiency " << divergence.meanEfficiency * 100
+        << " %, wasted " << divergence.wastedIterations * 100
+        << " % of executed iterations, interior-only " << divergence.uniformInteriorGroups * 100 << " %\n";
+}
+
+void printWorkloadStats(const WorkloadStats& stats, int maxIter) {
+    int pixels = stats.interiorCount;
+    for (int count : stats.histogram) {
+        pixels += count;
+    }
+    cout << "\nWorkload:\n";
+    cout << "    Total iterations: " << stats.totalIterations
+        << " (" << (double)stats.totalIterations / pixels << " per pixel)\n";
+    cout << "    Interior: " << stats.interiorFraction * 100 << " % of pixels, "
+        << (double)stats.interiorCount * maxIter / stats.totalIterations * 100 << " % of iterations\n";
+    cout << "    Escape iteration histogram:\n";
+    for (size_t i = 0; i < stats.histogram.size(); i++) {
+        int low = i == 0 ? 0 : 1 << (i - 1);
+        int high = i == 0 ? 0 : (1 << i) - 1;
+        if (stats.histogram[i] == 0) {
+            continue;
+        }
+        cout << "        " << setw(6) << low << " - " << setw(6) << min(high, maxIter - 1) << ": " << stats.histogram[i] << "\n";
+    }
+    printDivergence("SIMD group", stats.simd);
+    printDivergence("Work-group", stats.workGroup);
+}
+
+void writeHeatmap(const int* iters, int width, int height, int maxIter, const string& fileName) {
+    cv::Mat cost(height, width, CV_8UC1);
+    double scale = 255.0 / log((double)maxIter + 1);
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        uchar* rowPtr = cost.data + (height - y - 1) * cost.step;
+        for (int x = 0; x < width; x++) {
+            rowPtr[x] = (uchar)(log((double)pixelCost(iters[y * width + x], maxIter) + 1) * scale);
+        }
+    }
+    cv::Mat heatmap;
+    cv::applyColorMap(cost, heatmap, cv::COLORMAP_INFERNO);
+    writeImage(heatmap, fileName);
+}
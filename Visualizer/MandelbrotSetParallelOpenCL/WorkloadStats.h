@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef WORKLOAD_STATS_H
+#define WORKLOAD_STATS_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Lanes that run in lockstep on a GPU, a work-group is split into groups of this size
+const int SIMD_WIDTH = 32;
+
+// How many iterations lanes of one group spend waiting for the slowest lane.
+// Efficiency is useful iterations / (slowest lane * lanes), 1 means no divergence.
+struct DivergenceStats {
+    int groupSize; // work-items per group
+    double meanEfficiency;
+    double wastedIterations;
+    double uniformInteriorGroups; // fraction of groups made only of interior points
+};
+
+struct WorkloadStats {
+    unsigned long long totalIterations;
+    double interiorFraction;
+    // histogram[0] counts pixels escaping in iteration 0, histogram[i] those in [2^(i-1), 2^i)
+    vector<int> histogram;
+    int interiorCount;
+    DivergenceStats simd;
+    DivergenceStats workGroup;
+};
+
+// Cost of a pixel is the number of iterations it ran, escaped pixels ran their escape iteration + 1
+// The work-group shape is the one the kernel was launched with
+WorkloadStats computeWorkloadStats(const int* iters, int width, int height, int maxIter, int groupWidth, int groupHeight);
+void printWorkloadStats(const WorkloadStats& stats, int maxIter);
+// Log scaled per-pixel cost, rows flipped like the rendered image
+void writeHeatmap(const int* iters, int width, int height, int maxIter, const string& fileName);
+#endif
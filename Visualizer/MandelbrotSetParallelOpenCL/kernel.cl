@@ -1,13 +1,47 @@
+// Built with -D COMPACT_ITERS when max_iter fits 16 bits, -1 then stores as 0xFFFF
+#ifdef COMPACT_ITERS
+typedef ushort iter_t;
+#else
+typedef int iter_t;
+#endif
+
 typedef struct {
 	double real;
 	double imag;
 } Complex;
 
-__kernel void calculateIters(__global Complex* IN, __global int* OUT, const unsigned int max_iter)
+// Formula specialization through build options, see formulaBuildOptions: z -> z^FORMULA_POWER + c,
+// FORMULA_BURNING_SHIP takes absolute values of z first, FORMULA_JULIA iterates from the pixel with c = (JULIA_RE, JULIA_IM)
+#ifndef FORMULA_POWER
+#define FORMULA_POWER 2
+#endif
+#ifdef FORMULA_BURNING_SHIP
+#define FORMULA_ABS(v) fabs(v)
+#else
+#define FORMULA_ABS(v) (v)
+#endif
+
+__kernel void calculateIters(__global Complex* IN, __global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height)
 {
-	int idx = get_global_id(0);
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	// The global size is padded to a multiple of the work-group shape
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
 	Complex c = IN[idx];
 	
+#ifdef FORMULA_JULIA
+	double x0 = JULIA_RE;
+	double y0 = JULIA_IM;
+
+	double x = c.real;
+	double y = c.imag;
+
+	double x2 = x * x;
+	double y2 = y * y;
+#else
 	double x0 = c.real;
 	double y0 = c.imag;
 
@@ -16,11 +50,31 @@ __kernel void calculateIters(__global Complex* IN, __global int* OUT, const unsi
 
 	double x = 0;
 	double y = 0;
+#endif
 	
 	int result = -1;
 	for (int i = 0; i < max_iter; i++) {
+#if FORMULA_POWER == 2
+#ifdef FORMULA_BURNING_SHIP
+		y = 2 * fabs(x * y) + y0;
+#else
 		y = (x + x) * y + y0;
+#endif
 		x = x2 - y2 + x0;
+#else
+		// The loop over the constant power is unrolled by the compiler
+		double zr = FORMULA_ABS(x);
+		double zi = FORMULA_ABS(y);
+		double pr = zr;
+		double pi = zi;
+		for (int p = 1; p < FORMULA_POWER; p++) {
+			double t = pr * zr - pi * zi;
+			pi = pr * zi + pi * zr;
+			pr = t;
+		}
+		x = pr + x0;
+		y = pi + y0;
+#endif
 		x2 = x * x;
 		y2 = y * y;
 		if (x2 + y2 > 4) {
@@ -29,7 +83,60 @@ __kernel void calculateIters(__global Complex* IN, __global int* OUT, const unsi
 		}
 	}
 
-	OUT[idx] = result;
+	OUT[idx] = (iter_t)result;
+
+	return;
+}
+
+// Escape radius 64, a large radius makes the distance estimate more accurate
+#define DE_ESCAPE_RADIUS_SQUARED 4096
+
+// Also tracks dz/dc = 2 * z * dz/dc + 1 and writes the exterior distance estimate 2|z|ln|z|/|dz/dc| in pixels
+__kernel void calculateDistances(__global Complex* IN, __global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height,
+	__global float* DIST, const double pixel_size)
+{
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
+	Complex c = IN[idx];
+
+	double x0 = c.real;
+	double y0 = c.imag;
+
+	double x2 = 0;
+	double y2 = 0;
+
+	double x = 0;
+	double y = 0;
+
+	double dx = 0;
+	double dy = 0;
+
+	int result = -1;
+	for (int i = 0; i < max_iter; i++) {
+		double ndx = 2 * (x * dx - y * dy) + 1;
+		dy = 2 * (x * dy + y * dx);
+		dx = ndx;
+		y = (x + x) * y + y0;
+		x = x2 - y2 + x0;
+		x2 = x * x;
+		y2 = y * y;
+		if (x2 + y2 > DE_ESCAPE_RADIUS_SQUARED) {
+			result = i;
+			break;
+		}
+	}
+
+	OUT[idx] = (iter_t)result;
+	float distance = 0;
+	if (result != -1) {
+		double r2 = x2 + y2;
+		distance = sqrt(r2) * log(r2) / sqrt(dx * dx + dy * dy) / pixel_size;
+	}
+	DIST[idx] = distance;
 
 	return;
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+typedef struct {
+	double real;
+	double imag;
+} Complex;
+
+// Runs at most chunk iterations of every active pixel. Pixels that escape or reach
+// max_iter write their result, the rest store z and append their index to ACTIVE_OUT,
+// so the next launch only covers pixels that are still iterating.
+// In the first launch (first_iter == 0) every pixel is active and ACTIVE_IN is not read.
+__kernel void iterateChunk(__global Complex* IN, __global Complex* Z, __global int* OUT,
+	__global const unsigned int* ACTIVE_IN, __global unsigned int* ACTIVE_OUT, __global unsigned int* ACTIVE_COUNT,
+	const unsigned int active_count, const unsigned int first_iter, const unsigned int chunk, const unsigned int max_iter)
+{
+	__local unsigned int group_count;
+	__local unsigned int group_base;
+
+	unsigned int gid = get_global_id(0);
+	// Global size is padded to a multiple of the work-group size, extra lanes only join the barriers
+	bool valid = gid < active_count;
+	unsigned int idx = first_iter == 0 ? gid : (valid ? ACTIVE_IN[gid] : 0);
+
+	if (get_local_id(0) == 0) {
+		group_count = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	bool active = false;
+	if (valid) {
+		Complex c = IN[idx];
+		double x0 = c.real;
+		double y0 = c.imag;
+
+		Complex z = { 0, 0 };
+		if (first_iter != 0) {
+			z = Z[idx];
+		}
+		double x = z.real;
+		double y = z.imag;
+		double x2 = x * x;
+		double y2 = y * y;
+
+		unsigned int last_iter = min(first_iter + chunk, max_iter);
+		int result = -1;
+		for (unsigned int i = first_iter; i < last_iter; i++) {
+			y = (x + x) * y + y0;
+			x = x2 - y2 + x0;
+			x2 = x * x;
+			y2 = y * y;
+			if (x2 + y2 > 4) {
+				result = i;
+				break;
+			}
+		}
+
+		if (result != -1 || last_iter == max_iter) {
+			OUT[idx] = result;
+		}
+		else {
+			Z[idx] = (Complex){ x, y };
+			active = true;
+		}
+	}
+
+	// Compact within the work-group first, so only one global atomic is issued per group
+	unsigned int local_position = 0;
+	if (active) {
+		local_position = atomic_inc(&group_count);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if (get_local_id(0) == 0) {
+		group_base = group_count > 0 ? atomic_add(ACTIVE_COUNT, group_count) : 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if (active) {
+		ACTIVE_OUT[group_base + local_position] = idx;
+	}
+}
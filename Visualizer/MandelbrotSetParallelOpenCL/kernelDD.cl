@@ -0,0 +1,119 @@
+#pragma OPENCL FP_CONTRACT OFF
+
+// Built with -D COMPACT_ITERS when max_iter fits 16 bits, -1 then stores as 0xFFFF
+#ifdef COMPACT_ITERS
+typedef ushort iter_t;
+#else
+typedef int iter_t;
+#endif
+
+typedef struct {
+	double real[2]; // double-double, high part first
+	double imag[2];
+} ComplexDD;
+
+typedef struct {
+	double hi;
+	double lo;
+} DoubleDouble;
+
+inline DoubleDouble twoSum(double a, double b) {
+	DoubleDouble r;
+	r.hi = a + b;
+	double bb = r.hi - a;
+	r.lo = (a - (r.hi - bb)) + (b - bb);
+	return r;
+}
+
+// Only valid when |a| >= |b|
+inline DoubleDouble quickTwoSum(double a, double b) {
+	DoubleDouble r;
+	r.hi = a + b;
+	r.lo = b - (r.hi - a);
+	return r;
+}
+
+inline DoubleDouble twoProd(double a, double b) {
+	DoubleDouble r;
+	r.hi = a * b;
+	r.lo = fma(a, b, -r.hi);
+	return r;
+}
+
+inline DoubleDouble addDD(DoubleDouble a, DoubleDouble b) {
+	DoubleDouble s = twoSum(a.hi, b.hi);
+	DoubleDouble t = twoSum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = quickTwoSum(s.hi, s.lo);
+	s.lo += t.lo;
+	return quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble subDD(DoubleDouble a, DoubleDouble b) {
+	b.hi = -b.hi;
+	b.lo = -b.lo;
+	return addDD(a, b);
+}
+
+inline DoubleDouble mulDD(DoubleDouble a, DoubleDouble b) {
+	DoubleDouble p = twoProd(a.hi, b.hi);
+	p.lo = fma(a.hi, b.lo, fma(a.lo, b.hi, p.lo));
+	return quickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble sqrDD(DoubleDouble a) {
+	DoubleDouble p = twoProd(a.hi, a.hi);
+	p.lo = fma(a.hi + a.hi, a.lo, p.lo);
+	return quickTwoSum(p.hi, p.lo);
+}
+
+// Multiplying by two is exact, no renormalization needed
+inline DoubleDouble mul2DD(DoubleDouble a) {
+	a.hi += a.hi;
+	a.lo += a.lo;
+	return a;
+}
+
+__kernel void calculateIters(__global ComplexDD* IN, __global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height)
+{
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	// The global size is padded to a multiple of the work-group shape
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
+	ComplexDD c = IN[idx];
+
+	DoubleDouble x0;
+	x0.hi = c.real[0];
+	x0.lo = c.real[1];
+	DoubleDouble y0;
+	y0.hi = c.imag[0];
+	y0.lo = c.imag[1];
+
+	DoubleDouble x2 = { 0, 0 };
+	DoubleDouble y2 = { 0, 0 };
+
+	DoubleDouble x = { 0, 0 };
+	DoubleDouble y = { 0, 0 };
+
+	int result = -1;
+	for (int i = 0; i < max_iter; i++) {
+		y = addDD(mul2DD(mulDD(x, y)), y0);
+		//y = (x + x) * y + y0;
+		x = addDD(subDD(x2, y2), x0);
+		//x = x2 - y2 + x0;
+		x2 = sqrDD(x);
+		y2 = sqrDD(y);
+		// The low parts cannot change the outcome of the bailout test
+		if (x2.hi + y2.hi > 4) {
+			result = i;
+			break;
+		}
+	}
+
+	OUT[idx] = (iter_t)result;
+
+	return;
+}
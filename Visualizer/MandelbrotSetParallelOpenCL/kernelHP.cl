@@ -1,8 +1,11 @@
-typedef struct {
-	uint real[4]; // 4 bytes for whole part and 12 bytes for fraction part, using big endian
-	uint imag[4];
-} ComplexHP;
+// Built with -D COMPACT_ITERS when max_iter fits 16 bits, -1 then stores as 0xFFFF
+#ifdef COMPACT_ITERS
+typedef ushort iter_t;
+#else
+typedef int iter_t;
+#endif
 
+// Fixed point numbers are 4 uints, 4 bytes for whole part and 12 bytes for fraction part, using big endian
 #define WHOLE_PART 1
 #define FRACTION_PART 3
 #define WHOLE_BITS WHOLE_PART * 32
@@ -109,17 +112,51 @@ void mulCmplFixed(const uint* a, const uint* b, uint c[4]) {
 		cmplFixed(c, c);
 }
 
-__kernel void calculateIters(__global ComplexHP* IN, __global int* OUT, const unsigned int max_iter)
+// Column or row k lies at start + k * step, or start - k * step when descending. stepLow holds the step bits below
+// the last limb, the carry of k * stepLow is added to the offset, like mapAxisFixedPoint does on the host.
+typedef struct {
+	uint start[FP_SIZE];
+	uint step[FP_SIZE];
+	uint stepLow[FP_SIZE];
+	int descending;
+} FixedAxis;
+
+void axisCoordinate(const FixedAxis* axis, uint k, uint c[FP_SIZE]) {
+	// stepLow is a pure fraction, the carry out of its fraction limbs is floor(k * stepLow)
+	ulong carry = 0;
+	for (int i = FP_SIZE - 1; i >= WHOLE_PART; i--) {
+		carry = ((ulong)axis->stepLow[i] * k + carry) >> 32;
+	}
+	uint offset[FP_SIZE];
+	for (int i = FP_SIZE - 1; i >= 0; i--) {
+		ulong temp = (ulong)axis->step[i] * k + carry;
+		offset[i] = (uint)temp;
+		carry = temp >> 32;
+	}
+	if (axis->descending) {
+		subFixed(axis->start, offset, c);
+	}
+	else {
+		addFixed(axis->start, offset, c);
+	}
+}
+
+// Pixels are derived from their column and row, so no per-pixel input is transferred
+__kernel void calculateIters(__global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height,
+	const FixedAxis real_axis, const FixedAxis imag_axis)
 {
-	int idx = get_global_id(0);
-	ComplexHP c = IN[idx];
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	// The global size is padded to a multiple of the work-group shape
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
 
 	uint x0[FP_SIZE];
 	uint y0[FP_SIZE];
-	for (int i = 0; i < FP_SIZE; i++) {
-		x0[i] = c.real[i];
-		y0[i] = c.imag[i];
-	}
+	axisCoordinate(&real_axis, col, x0);
+	axisCoordinate(&imag_axis, row, y0);
 
 	uint x2[FP_SIZE] = { 0,0,0,0 };
 	uint y2[FP_SIZE] = { 0,0,0,0 };
@@ -141,7 +178,7 @@ __kernel void calculateIters(__global ComplexHP* IN, __global int* OUT, const un
 		addFixed(temp, x0, x);
 		//x = x2 - y2 + x0;
 
-		mulCmplFixed(x, x, x2); // THIS PART DOES NOT WORK, X is right but product X*X is wrong
+		mulCmplFixed(x, x, x2);
 		//x2 = x * x;
 
 		mulCmplFixed(y, y, y2);
@@ -158,7 +195,81 @@ __kernel void calculateIters(__global ComplexHP* IN, __global int* OUT, const un
 		//}
 	}
 
-	OUT[idx] = result;
+	OUT[idx] = (iter_t)result;
+
+	return;
+}
+
+// Escape radius 64 keeps the squares within the 32 whole bits, a large radius makes the distance estimate more accurate
+#define DE_ESCAPE_RADIUS_SQUARED 4096
+
+double toDouble(const uint* a) {
+	return (double)(int)a[0] + a[1] * 0x1.0p-32 + a[2] * 0x1.0p-64 + a[3] * 0x1.0p-96;
+}
+
+// Also tracks dz/dc = 2 * z * dz/dc + 1 in double, which keeps enough precision for the estimate,
+// and writes the exterior distance estimate 2|z|ln|z|/|dz/dc| in pixels
+// PIXELS lists image indices laid out as width x height, each one is mapped to its coordinates through the axes
+__kernel void calculateDistances(__global const int* PIXELS, __global iter_t* OUT, const unsigned int max_iter, const unsigned int width, const unsigned int height,
+	__global float* DIST, const double pixel_size, const unsigned int image_width, const FixedAxis real_axis, const FixedAxis imag_axis)
+{
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
+	int pixel = PIXELS[idx];
+
+	uint x0[FP_SIZE];
+	uint y0[FP_SIZE];
+	axisCoordinate(&real_axis, pixel % image_width, x0);
+	axisCoordinate(&imag_axis, pixel / image_width, y0);
+
+	uint x2[FP_SIZE] = { 0,0,0,0 };
+	uint y2[FP_SIZE] = { 0,0,0,0 };
+
+	uint x[FP_SIZE] = { 0,0,0,0 };
+	uint y[FP_SIZE] = { 0,0,0,0 };
+
+	uint temp[FP_SIZE];
+	uint escapeFixed[FP_SIZE] = { DE_ESCAPE_RADIUS_SQUARED, 0, 0, 0 };
+
+	double dx = 0;
+	double dy = 0;
+
+	int result = -1;
+	for (int i = 0; i < max_iter; i++) {
+		double zx = toDouble(x);
+		double zy = toDouble(y);
+		double ndx = 2 * (zx * dx - zy * dy) + 1;
+		dy = 2 * (zx * dy + zy * dx);
+		dx = ndx;
+
+		addFixed(x, x, temp);
+		mulCmplFixed(temp, y, temp);
+		addFixed(temp, y0, y);
+
+		subFixed(x2, y2, temp);
+		addFixed(temp, x0, x);
+
+		mulCmplFixed(x, x, x2);
+		mulCmplFixed(y, y, y2);
+
+		addFixed(x2, y2, temp);
+		if (gtFixed(temp, escapeFixed)) {
+			result = i;
+			break;
+		}
+	}
+
+	OUT[idx] = (iter_t)result;
+	float distance = 0;
+	if (result != -1) {
+		double r2 = toDouble(x2) + toDouble(y2);
+		distance = sqrt(r2) * log(r2) / sqrt(dx * dx + dy * dy) / pixel_size;
+	}
+	DIST[idx] = distance;
 
 	return;
-}
\ No newline at end of file
+}
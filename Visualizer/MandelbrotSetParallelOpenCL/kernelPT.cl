@@ -0,0 +1,152 @@
+// Built with -D COMPACT_ITERS when max_iter fits 16 bits, -1 then stores as 0xFFFF
+#ifdef COMPACT_ITERS
+typedef ushort iter_t;
+#else
+typedef int iter_t;
+#endif
+
+typedef struct {
+	double real;
+	double imag;
+} Complex;
+
+// Extended-exponent floating point number, value = mantissa * 2^exponent
+typedef struct {
+	double mantissa;
+	int exponent;
+} FloatExp;
+
+// Past this exponent difference the smaller operand does not affect the sum
+#define MAX_EXPONENT_DIFF 60
+// Deltas above 2^DOUBLE_EXPONENT are iterated with plain doubles
+#define DOUBLE_EXPONENT -960
+
+inline FloatExp makeFE(double mantissa, int exponent) {
+	int shift;
+	FloatExp result;
+	result.mantissa = frexp(mantissa, &shift);
+	result.exponent = exponent + shift;
+	return result;
+}
+
+inline FloatExp addFE(FloatExp a, FloatExp b) {
+	if (a.mantissa == 0) {
+		return b;
+	}
+	if (b.mantissa == 0) {
+		return a;
+	}
+	int diff = a.exponent - b.exponent;
+	if (diff > MAX_EXPONENT_DIFF) {
+		return a;
+	}
+	if (diff < -MAX_EXPONENT_DIFF) {
+		return b;
+	}
+	if (diff >= 0) {
+		return makeFE(a.mantissa + ldexp(b.mantissa, -diff), a.exponent);
+	}
+	return makeFE(ldexp(a.mantissa, diff) + b.mantissa, b.exponent);
+}
+
+inline FloatExp mulFE(FloatExp a, FloatExp b) {
+	return makeFE(a.mantissa * b.mantissa, a.exponent + b.exponent);
+}
+
+inline FloatExp mulDoubleFE(FloatExp a, double b) {
+	return makeFE(a.mantissa * b, a.exponent);
+}
+
+inline double toDoubleFE(FloatExp a) {
+	return ldexp(a.mantissa, a.exponent);
+}
+
+// True once a delta is large enough to continue in plain doubles
+inline bool fitsDouble(FloatExp re, FloatExp im) {
+	return (re.mantissa != 0 && re.exponent > DOUBLE_EXPONENT) || (im.mantissa != 0 && im.exponent > DOUBLE_EXPONENT);
+}
+
+// Iterates the delta from a high precision reference orbit, dz' = 2 * Z * dz + dz^2 + dc.
+// The delta starts out as a FloatExp and switches to double once it is back in range.
+// When the reference orbit ends, or the pixel gets closer to zero than the reference,
+// the pixel is rebased onto the start of the orbit.
+__kernel void calculateIters(__global Complex* REF, const unsigned int ref_length, __global iter_t* OUT, const unsigned int max_iter,
+	const unsigned int width, const unsigned int height, const FloatExp dc0_real, const FloatExp dc0_imag, const FloatExp step_real, const FloatExp step_imag)
+{
+	int col = get_global_id(0);
+	int row = get_global_id(1);
+	// The global size is padded to a multiple of the work-group shape
+	if (col >= width || row >= height) {
+		return;
+	}
+	int idx = row * width + col;
+
+	FloatExp dcr = addFE(dc0_real, mulDoubleFE(step_real, col));
+	FloatExp dci = addFE(dc0_imag, mulDoubleFE(step_imag, row));
+
+	FloatExp dzr = { 0, 0 };
+	FloatExp dzi = { 0, 0 };
+
+	int result = -1;
+	int n = 0;
+	int i = 0;
+	for (; i < max_iter && !fitsDouble(dzr, dzi); i++) {
+		double zr = REF[n].real;
+		double zi = REF[n].imag;
+
+		FloatExp nr = addFE(mulDoubleFE(dzr, 2 * zr), mulDoubleFE(dzi, -2 * zi));
+		nr = addFE(nr, addFE(mulFE(dzr, dzr), mulDoubleFE(mulFE(dzi, dzi), -1)));
+		nr = addFE(nr, dcr);
+		FloatExp ni = addFE(mulDoubleFE(dzi, 2 * zr), mulDoubleFE(dzr, 2 * zi));
+		ni = addFE(ni, mulDoubleFE(mulFE(dzr, dzi), 2));
+		ni = addFE(ni, dci);
+		dzr = nr;
+		dzi = ni;
+		n++;
+
+		zr = REF[n].real + toDoubleFE(dzr);
+		zi = REF[n].imag + toDoubleFE(dzi);
+		if (zr * zr + zi * zi > 4) {
+			result = i;
+			break;
+		}
+		if (n == ref_length - 1) {
+			dzr = makeFE(zr, 0);
+			dzi = makeFE(zi, 0);
+			n = 0;
+		}
+	}
+
+	if (result == -1) {
+		double dr = toDoubleFE(dzr);
+		double di = toDoubleFE(dzi);
+		double cr = toDoubleFE(dcr);
+		double ci = toDoubleFE(dci);
+		for (; i < max_iter; i++) {
+			double zr = REF[n].real;
+			double zi = REF[n].imag;
+
+			double nr = 2 * (zr * dr - zi * di) + (dr * dr - di * di) + cr;
+			di = 2 * (zr * di + zi * dr) + 2 * dr * di + ci;
+			dr = nr;
+			n++;
+
+			zr = REF[n].real + dr;
+			zi = REF[n].imag + di;
+			double mag = zr * zr + zi * zi;
+			if (mag > 4) {
+				result = i;
+				break;
+			}
+			if (mag < dr * dr + di * di || n == ref_length - 1) {
+				dr = zr;
+				di = zi;
+				n = 0;
+			}
+		}
+	}
+
+	OUT[idx] = (iter_t)result;
+
+	return;
+}
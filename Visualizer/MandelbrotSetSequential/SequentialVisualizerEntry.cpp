@@ -4,6 +4,7 @@
 #include <vector>
 #include <iomanip>
 #include <iostream>
+#include <chrono>
 
 using namespace std;
 //const double RE_START = -2.0;
@@ -161,22 +162,14 @@ void createMandelbrotSet() {
     colors.push_back(c1);
     ColorPalette palette(colors, PALETTE_LENGTH);
 
-    chrono::steady_clock::time_point start;
-    chrono::steady_clock::time_point end;
-    chrono::steady_clock::time_point startX;
-    chrono::steady_clock::time_point endX;
-    
-    start = chrono::high_resolution_clock::now();
-    unsigned long long totalTime = 0;
+    // Timing the whole loop, a clock pair around every pixel would cost more than most pixels
+    auto start = chrono::high_resolution_clock::now();
     for (int i = 0; i < IMAGE_HEIGHT; i++) {
         for (int j = 0; j < IMAGE_WIDTH; j++) {
             double realPart = mapVal(j, 0, IMAGE_WIDTH, RE_START, RE_END);
             double imaginaryPart = mapVal(i, 0, IMAGE_HEIGHT, IM_START, IM_END);
             complex<double> point(realPart, imaginaryPart);
-            startX = chrono::high_resolution_clock::now();
             int totalIters = calculateEscapeIterOptimized(point);
-            endX = chrono::high_resolution_clock::now();
-            totalTime += chrono::duration_cast<chrono::nanoseconds>(endX - startX).count();
             int idx = j + (i * IMAGE_WIDTH);
             if (totalIters == -1) {
                 Color black{};
@@ -190,9 +183,12 @@ void createMandelbrotSet() {
             }     
         }
     }
+    auto end = chrono::high_resolution_clock::now();
+    std::cout << "Calculating escape iteration and coloring: " << chrono::duration<double, milli>(end - start).count() << " ms\n";
+    start = chrono::high_resolution_clock::now();
     createColorImage(pixels);
     end = chrono::high_resolution_clock::now();
-    std::cout << setprecision(16) << "Pixel mapping: " << totalTime << " ns\n\n";
+    std::cout << "Image building: " << chrono::duration<double, milli>(end - start).count() << " ms\n";
     delete[] pixels;
 }
 